@@ -116,7 +116,7 @@ int main(int argc, char** argv)
 
 	const char* controls_fn_str[] = { "generic", "trigger", "trigger_click", "squeeze", "menu", "home",
 		"analog-x", "analog-y", "anlog_press", "button-a", "button-b", "button-x", "button-y",
-		"volume-up", "volume-down", "mic-mute"};
+		"volume-up", "volume-down", "mic-mute", "proximity", "volume"};
 
 	const char* controls_type_str[] = {"digital", "analog"};
 
@@ -157,6 +157,15 @@ int main(int argc, char** argv)
 			{
 				printf("%f ", control_state[i]);
 			}
+
+			// print any control changes since the last frame
+			ohmd_control_event events[16];
+			int num_events = ohmd_device_get_control_events(hmd, events, 16);
+			for(int i = 0; i < num_events; i++)
+			{
+				printf("\n%-25s%s %f -> %f", "control event:", controls_fn_str[controls_fn[events[i].control]],
+					events[i].old_value, events[i].new_value);
+			}
 		}
 		puts("");
 			
@@ -13,6 +13,8 @@
 #ifndef OPENHMD_H
 #define OPENHMD_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -45,6 +47,7 @@ typedef enum {
 	OHMD_S_INVALID_PARAMETER = -2,
 	OHMD_S_UNSUPPORTED = -3,
 	OHMD_S_INVALID_OPERATION = -4,
+	OHMD_S_TIMEOUT = -5,
 
 	/** OHMD_S_USER_RESERVED and below can be used for user purposes, such as errors within ohmd wrappers, etc. */
 	OHMD_S_USER_RESERVED = -16384,
@@ -86,6 +89,8 @@ typedef enum {
 	OHMD_VOLUME_PLUS    = 13,
 	OHMD_VOLUME_MINUS   = 14,
 	OHMD_MIC_MUTE       = 15,
+	OHMD_PROXIMITY      = 16, // 1 while the device is being worn
+	OHMD_VOLUME         = 17,
 } ohmd_control_hint;
 
 /** Control type. Indicates whether controls are digital or analog. */
@@ -163,6 +168,30 @@ typedef enum {
 	/** float[OHMD_CONTROL_COUNT] (get): Get the state of the device's controls. */
 	OHMD_CONTROLS_STATE                = 22,
 
+	/** float[OHMD_TRACKING_SENSOR_COUNT * 6] (get): Positions (x, y, z) in metres followed by normals (x, y, z) of
+	    the device's tracking sensors or LEDs, as calibrated by the manufacturer, relative to the device. */
+	OHMD_TRACKING_SENSOR_MODEL         = 23,
+
+	/**
+	 * float[OHMD_CAMERA_COUNT * 27] (get): Factory calibration of the device's cameras, 27 values per camera.
+	 *
+	 * Values are: distortion model (see ohmd_camera_distortion_model), width and height in pixels, fx, fy, cx and cy
+	 * in pixels, distortion coefficients k1 to k6, p1 and p2 (unused ones are 0), a 3x3 row-major rotation matrix
+	 * and an X, Y, Z translation in metres from the camera to the device.
+	 **/
+	OHMD_CAMERA_CALIBRATION            = 24,
+
+	/**
+	 * float[180] (get): Factory calibration of the device's gyroscope, accelerometer and magnetometer, in that
+	 * order, 60 values per sensor.
+	 *
+	 * Values are: a 3x3 row-major rotation matrix and an X, Y, Z translation in metres from the sensor to the
+	 * device, the bias model (4 coefficients c0..c3 of c0 + c1 * t + c2 * t^2 + c3 * t^3 in temperature t for
+	 * each of X, Y, Z) and the mixing matrix model (4 such coefficients for each element of a 3x3 row-major
+	 * matrix). Sensors without calibration report an identity rotation and mixing matrix and zero otherwise.
+	 **/
+	OHMD_IMU_CALIBRATION               = 25,
+
 } ohmd_float_value;
 
 /** A collection of int value information types used for getting information with ohmd_device_geti(). */
@@ -185,6 +214,38 @@ typedef enum {
 	
 	/** int[OHMD_CONTROL_COUNT] (get, ohmd_geti()): Get whether controls are digital or analog. */
 	OHMD_CONTROLS_TYPES                   =  6,
+
+	/** int[1] (get, ohmd_geti()/ohmd_list_geti()): Gets the group of the device, devices that are part of the same
+	    physical device (e.g. an HMD and its controllers) share a group. See: ohmd_list_open_device_group(). */
+	OHMD_DEVICE_GROUP                     =  7,
+
+	/** int[2] (get, ohmd_geti()): Get the number of sensor samples the driver has processed, followed by the number
+	    it detected as lost (e.g. from gaps in the sample sequence numbers). Drivers that can't detect loss report 0. */
+	OHMD_SAMPLE_STATS                     =  8,
+
+	/** int[1] (get, ohmd_geti()): Get the number of tracking sensors or LEDs described by OHMD_TRACKING_SENSOR_MODEL,
+	    0 if the device doesn't provide a model. Some devices only provide it a while after being opened, query
+	    the count again to pick it up. OHMD_TRACKING_SENSOR_MODEL and OHMD_TRACKING_SENSOR_PATTERNS never return
+	    more entries than the count last returned here. */
+	OHMD_TRACKING_SENSOR_COUNT            =  9,
+
+	/** int[1] (get, ohmd_geti()): Get the number of cameras described by OHMD_CAMERA_CALIBRATION, 0 if the device
+	    doesn't provide a camera calibration. */
+	OHMD_CAMERA_COUNT                     = 10,
+
+	/** int[OHMD_TRACKING_SENSOR_COUNT] (get, ohmd_geti()): Get the blink pattern of each tracking LED described by
+	    OHMD_TRACKING_SENSOR_MODEL, one bit per camera frame of the pattern sequence, set where the LED is bright.
+	    0 for sensors that don't blink or whose pattern isn't known. */
+	OHMD_TRACKING_SENSOR_PATTERNS         = 11,
+
+	/**
+	 * int[4] (get, ohmd_geti()): Get the latest camera exposure reported by the device, for matching camera frames
+	 * to the device's IMU data and LED blink patterns.
+	 *
+	 * Values are: exposure count, exposure timestamp, timestamp of the latest IMU sample and the LED pattern phase.
+	 * Timestamps are in microseconds of the device's clock, as unsigned 32 bit values that wrap around.
+	 **/
+	OHMD_TRACKING_EXPOSURE_INFO           = 12,
 } ohmd_int_value;
 
 /** A collection of data information types used for setting information with ohmd_set_data(). */
@@ -204,6 +265,13 @@ typedef enum {
 	/** int[1] (set, default: 1): Set this to 0 to prevent OpenHMD from creating background threads to do automatic device ticking.
 	    Call ohmd_update(); must be called frequently, at least 10 times per second, if the background threads are disabled. */
 	OHMD_IDS_AUTOMATIC_UPDATE = 0,
+	/** int[1] (set, default: 0): Set this to 1 to feed every raw sensor sample to sensor fusion on devices that
+	    sample faster than they report (Windows Mixed Reality), instead of averaging them. Uses more CPU. */
+	OHMD_IDS_HIGH_RATE_SENSORS = 1,
+	/** int[1] (set, default: 0): Set this to 1 to apply the temperature dependent terms of the factory IMU calibration
+	    (Windows Mixed Reality). The unit of the reported temperature is not confirmed, so only the constant terms are
+	    used by default. */
+	OHMD_IDS_TEMPERATURE_CALIBRATION = 2,
 } ohmd_int_settings;
 
 /** Device classes. */
@@ -228,6 +296,30 @@ typedef enum
 	OHMD_DEVICE_FLAGS_RIGHT_CONTROLLER    = 16,
 } ohmd_device_flags;
 
+/** Camera lens distortion models, see OHMD_CAMERA_CALIBRATION. */
+typedef enum
+{
+	/** Rational radial (k1..k6) and tangential (p1, p2) model, as used by OpenCV. */
+	OHMD_CAMERA_DISTORTION_RATIONAL = 0,
+	/** Equidistant fisheye model (k1..k4). */
+	OHMD_CAMERA_DISTORTION_FISHEYE  = 1,
+	/** Equidistant fisheye model with 6 radial (k1..k6) and 2 tangential (p1, p2) coefficients. */
+	OHMD_CAMERA_DISTORTION_FISHEYE62 = 2,
+} ohmd_camera_distortion_model;
+
+/** A change in the state of one of a device's controls, as returned by ohmd_device_get_control_events(). */
+typedef struct
+{
+	/** Time of the change in seconds, on the same clock as ohmd_sleep(). */
+	double time;
+	/** Index of the control, matching the OHMD_CONTROLS_STATE array. */
+	int control;
+	/** Value of the control before the change. */
+	float old_value;
+	/** Value of the control after the change. */
+	float new_value;
+} ohmd_control_event;
+
 /** An opaque pointer to a context structure. */
 typedef struct ohmd_context ohmd_context;
 
@@ -237,6 +329,31 @@ typedef struct ohmd_device ohmd_device;
 /** An opaque pointer to a structure representing arguments for a device. */
 typedef struct ohmd_device_settings ohmd_device_settings;
 
+/** Memory allocation functions used by a context, see ohmd_ctx_create_with_allocator(). */
+typedef struct
+{
+	/** Allocate size bytes, returning NULL on failure. The memory does not have to be cleared. */
+	void* (OHMD_APIENTRY *alloc)(size_t size, void* user_data);
+	/** Free memory returned by alloc. */
+	void (OHMD_APIENTRY *free)(void* ptr, void* user_data);
+	/** Passed unmodified to alloc and free. */
+	void* user_data;
+} ohmd_allocator;
+
+/** Memory usage of a context, as returned by ohmd_ctx_get_memory_stats(). */
+typedef struct
+{
+	/** Bytes currently allocated by the context, drivers and devices, not counting the context itself. */
+	size_t current_bytes;
+	/** The highest current_bytes has been since the context was created or the peak was last reset. */
+	size_t peak_bytes;
+	/** The number of allocations made since the context was created. */
+	size_t num_allocations;
+} ohmd_memory_stats;
+
+/** A function called after each update pass that changed a device pose, see ohmd_ctx_set_pose_callback(). */
+typedef void (OHMD_APIENTRY *ohmd_pose_callback)(ohmd_context* ctx, void* user_data);
+
 /**
  * Create an OpenHMD context.
  *
@@ -244,6 +361,28 @@ typedef struct ohmd_device_settings ohmd_device_settings;
  **/
 OHMD_APIENTRYDLL ohmd_context* OHMD_APIENTRY ohmd_ctx_create(void);
 
+/**
+ * Create an OpenHMD context that uses custom memory allocation functions.
+ *
+ * Every allocation made by the context, its drivers and devices, including temporary buffers used while parsing
+ * device configuration, goes through allocator. All memory is returned to it by ohmd_ctx_destroy, except device
+ * settings, which are returned by ohmd_device_settings_destroy.
+ *
+ * @param allocator The functions to use, copied into the context. NULL uses the C library allocator.
+ * @return a pointer to an allocated ohmd_context on success or NULL if it fails.
+ **/
+OHMD_APIENTRYDLL ohmd_context* OHMD_APIENTRY ohmd_ctx_create_with_allocator(const ohmd_allocator* allocator);
+
+/**
+ * Get the memory usage of a context.
+ *
+ * @param ctx A context.
+ * @param[out] out The memory usage.
+ * @param reset_peak If non-zero, the peak is reset to the current usage after reading it.
+ * @return 0 on success, <0 on failure.
+ **/
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_ctx_get_memory_stats(ohmd_context* ctx, ohmd_memory_stats* out, int reset_peak);
+
 /**
  * Destroy an OpenHMD context.
  *
@@ -366,6 +505,27 @@ OHMD_APIENTRYDLL ohmd_device* OHMD_APIENTRY ohmd_list_open_device(ohmd_context*
  **/
 OHMD_APIENTRYDLL ohmd_device* OHMD_APIENTRY ohmd_list_open_device_s(ohmd_context* ctx, int index, ohmd_device_settings* settings);
 
+/**
+ * Open all devices in the same group as a device.
+ *
+ * Opens every enumerated device that shares the OHMD_DEVICE_GROUP of the device at index, such as an HMD and
+ * the controllers that talk through it, in enumeration order. The devices share the underlying connection and
+ * are updated in a single pass, and the returned array tells the caller which devices belong together without
+ * having to match product strings.
+ *
+ * If any member fails to open, the ones already opened are closed again.
+ *
+ * ohmd_ctx_probe must be called before calling ohmd_list_open_device_group.
+ *
+ * @param ctx A (probed) context.
+ * @param index An index of any member of the group, between 0 and the value returned from ohmd_ctx_probe.
+ * @param settings A pointer to a device settings struct applied to every member, or NULL for the defaults.
+ * @param[out] out An array of at least max_devices entries receiving the opened devices.
+ * @param max_devices The size of out.
+ * @return the number of devices opened on success, <0 on failure.
+ **/
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_list_open_device_group(ohmd_context* ctx, int index, ohmd_device_settings* settings, ohmd_device** out, int max_devices);
+
 /**
  * Specify int settings in a device settings struct.
  *
@@ -378,6 +538,8 @@ OHMD_APIENTRYDLL ohmd_status OHMD_APIENTRY ohmd_device_settings_seti(ohmd_device
 /**
  * Create a device settings instance.
  *
+ * The memory comes from the context's allocator, but the settings may be destroyed after the context.
+ *
  * @param ctx A pointer to a valid ohmd_context.
  * @return a pointer to an allocated ohmd_context on success or NULL if it fails.
  **/
@@ -386,7 +548,7 @@ OHMD_APIENTRYDLL ohmd_device_settings* OHMD_APIENTRY ohmd_device_settings_create
 /**
  * Destroy a device settings instance.
  *
- * @param ctx The device settings instance to destroy.
+ * @param settings The device settings instance to destroy.
  **/
 OHMD_APIENTRYDLL void OHMD_APIENTRY ohmd_device_settings_destroy(ohmd_device_settings* settings);
 
@@ -452,6 +614,55 @@ OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_seti(ohmd_device* device, ohmd_in
  **/
 OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_set_data(ohmd_device* device, ohmd_data_value type, const void* in);
 
+/**
+ * Get control state changes from a device.
+ *
+ * Drains the device's control event queue, returning every control transition the driver has seen since the
+ * last call, in the order they happened. Transitions that happen between two frames are not lost, which makes
+ * this a better fit than polling OHMD_CONTROLS_STATE for detecting button presses.
+ *
+ * The queue is filled from the update path and can be drained from another thread without locking. If it is
+ * not drained often enough the oldest pending events are kept and newer ones are dropped.
+ *
+ * @param device An open device to retrieve the events from.
+ * @param[out] out An array of at least max_events ohmd_control_event entries.
+ * @param max_events The maximum number of events to return, any remaining events are returned by the next call.
+ * @return the number of events written to out, or <0 on failure.
+ **/
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_get_control_events(ohmd_device* device, ohmd_control_event* out, int max_events);
+
+/**
+ * Wait for a device to get a newer pose.
+ *
+ * Every time the update path sees the rotation or position of a device change its pose sequence number is
+ * incremented. This function blocks until the sequence number of the device differs from last_seq, or until
+ * timeout seconds have passed. Pass 0 as last_seq on the first call to get the current sequence number.
+ *
+ * This is meant to be called from a thread other than the one driving the updates, either the automatic update
+ * thread or a thread calling ohmd_ctx_update().
+ *
+ * @param device An open device to wait on.
+ * @param last_seq The last pose sequence number the caller has seen.
+ * @param timeout The maximum time to wait, in seconds.
+ * @param[out] out_seq The current pose sequence number of the device, may be NULL.
+ * @return OHMD_S_OK if there is a newer pose, OHMD_S_TIMEOUT if the timeout passed first, or <0 on failure.
+ **/
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_wait_pose(ohmd_device* device, unsigned int last_seq, double timeout, unsigned int* out_seq);
+
+/**
+ * Set a callback to be called after every update pass that changed the pose of one or more devices.
+ *
+ * With automatic updates the callback is called from the update thread, otherwise from within ohmd_ctx_update().
+ * The context lock is not held while the callback runs so it is safe to call ohmd_device_getf() from it, but it
+ * should return quickly as it delays the next update pass.
+ *
+ * @param ctx A context.
+ * @param callback The function to call, or NULL to remove the callback.
+ * @param user_data A pointer that is passed unmodified to the callback.
+ * @return 0 on success, <0 on failure.
+ **/
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_ctx_set_pose_callback(ohmd_context* ctx, ohmd_pose_callback callback, void* user_data);
+
 /**
  * Get the library version.
  *
@@ -188,7 +188,7 @@ static void _close_device(ohmd_device* device)
     LOGD("closing device");
     xgvr_priv* priv = _xgvr_priv_get(device);
     hid_close(priv->hid_handle);
-    free(priv);
+    ohmd_free(priv);
 }
 
 #define UDEV_WIKI_URL "https://github.com/OpenHMD/OpenHMD/wiki/Udev-rules-list"
@@ -240,7 +240,7 @@ static ohmd_device* _open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 
 cleanup:
     if (priv)
-        free(priv);
+        ohmd_free(priv);
 
     return NULL;
 }
@@ -258,18 +258,20 @@ static void _get_device_list(ohmd_driver* driver, ohmd_device_list* list)
             continue;
 
         while (cur_dev) {
-            ohmd_device_desc* desc = &list->devices[list->num_devices++];
+            ohmd_device_desc* desc = ohmd_device_list_add(list);
+            if(!desc)
+                break;
 
-            strcpy(desc->driver, "OpenHMD 3Glasses Driver");
-            strcpy(desc->vendor, "3Glasses");
-            strcpy(desc->product, platform_sku[i].desc);
+            desc->driver = ohmd_device_list_intern(list, "OpenHMD 3Glasses Driver");
+            desc->vendor = ohmd_device_list_intern(list, "3Glasses");
+            desc->product = ohmd_device_list_intern(list, platform_sku[i].desc);
 
             desc->id = platform_sku[i].sku;
 
             desc->device_class = OHMD_DEVICE_CLASS_HMD;
             desc->device_flags = OHMD_DEVICE_FLAGS_ROTATIONAL_TRACKING;
 
-            strcpy(desc->path, cur_dev->path);
+            desc->path = ohmd_device_list_intern(list, cur_dev->path);
             desc->driver_ptr = driver;
             cur_dev = cur_dev->next;
         }
@@ -282,7 +284,7 @@ static void _destroy_driver(ohmd_driver* drv)
 {
     LOGD("shutting down 3Glasses driver");
     hid_exit();
-    free(drv);
+    ohmd_free(drv);
 }
 
 ohmd_driver* ohmd_create_xgvr_drv(ohmd_context* ctx)
@@ -176,7 +176,7 @@ static int set_data(ohmd_device* device, ohmd_data_value type, void* in)
 static void close_device(ohmd_device* device)
 {
 	LOGD("closing Android device");
-	free(device);
+	ohmd_free(device);
 }
 
 static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
@@ -231,13 +231,15 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 
 static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 {
-	ohmd_device_desc* desc = &list->devices[list->num_devices++];
+	ohmd_device_desc* desc = ohmd_device_list_add(list);
+	if(!desc)
+		return;
 
-	strcpy(desc->driver, "OpenHMD Generic Android Driver");
-	strcpy(desc->vendor, "OpenHMD");
-	strcpy(desc->product, "Android Device");
+	desc->driver = ohmd_device_list_intern(list, "OpenHMD Generic Android Driver");
+	desc->vendor = ohmd_device_list_intern(list, "OpenHMD");
+	desc->product = ohmd_device_list_intern(list, "Android Device");
 
-	strcpy(desc->path, "(none)");
+	desc->path = ohmd_device_list_intern(list, "(none)");
 
 	desc->device_class = OHMD_DEVICE_CLASS_HMD;
 	desc->device_flags = OHMD_DEVICE_FLAGS_ROTATIONAL_TRACKING;
@@ -248,7 +250,7 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 static void destroy_driver(ohmd_driver* drv)
 {
 	LOGD("shutting down Android driver");
-	free(drv);
+	ohmd_free(drv);
 }
 
 ohmd_driver* ohmd_create_android_drv(ohmd_context* ctx)
@@ -188,7 +188,7 @@ static void close_device(ohmd_device* device)
 	LOGD("closing device");
 	rift_priv* priv = rift_priv_get(device);
 	hid_close(priv->handle);
-	free(priv);
+	ohmd_free(priv);
 }
 
 static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
@@ -266,7 +266,7 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 
 cleanup:
 	if(priv)
-		free(priv);
+		ohmd_free(priv);
 
 	return NULL;
 }
@@ -281,17 +281,19 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 		if (ohmd_wstring_match(cur_dev->manufacturer_string, L"DeePoon VR, Inc.") &&
 			ohmd_wstring_match(cur_dev->product_string, L"DeePoon Tracker Device")) {
 
-			ohmd_device_desc* desc = &list->devices[list->num_devices++];
+			ohmd_device_desc* desc = ohmd_device_list_add(list);
+			if(!desc)
+				break;
 
-			strcpy(desc->driver, "Deepoon Driver");
-			strcpy(desc->vendor, "Deepoon");
-			strcpy(desc->product, "Deepoon E2");
+			desc->driver = ohmd_device_list_intern(list, "Deepoon Driver");
+			desc->vendor = ohmd_device_list_intern(list, "Deepoon");
+			desc->product = ohmd_device_list_intern(list, "Deepoon E2");
 
 			desc->device_class = OHMD_DEVICE_CLASS_HMD;
 			desc->device_flags = OHMD_DEVICE_FLAGS_ROTATIONAL_TRACKING;
 
 			desc->revision = 0;
-			strcpy(desc->path, cur_dev->path);
+			desc->path = ohmd_device_list_intern(list, cur_dev->path);
 			desc->driver_ptr = driver;
 		}
 		cur_dev = cur_dev->next;
@@ -304,7 +306,7 @@ static void destroy_driver(ohmd_driver* drv)
 {
 	LOGD("shutting down driver");
 	hid_exit();
-	free(drv);
+	ohmd_free(drv);
 }
 
 ohmd_driver* ohmd_create_deepoon_drv(ohmd_context* ctx)
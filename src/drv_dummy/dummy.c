@@ -72,7 +72,7 @@ static int getf(ohmd_device* device, ohmd_float_value type, float* out)
 static void close_device(ohmd_device* device)
 {
 	LOGD("closing dummy device");
-	free(device);
+	ohmd_free(device);
 }
 
 static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
@@ -121,13 +121,15 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 
 	// HMD
 
-	desc = &list->devices[list->num_devices++];
+	desc = ohmd_device_list_add(list);
+	if(!desc)
+		return;
 
-	strcpy(desc->driver, "OpenHMD Null Driver");
-	strcpy(desc->vendor, "OpenHMD");
-	strcpy(desc->product, "HMD Null Device");
+	desc->driver = ohmd_device_list_intern(list, "OpenHMD Null Driver");
+	desc->vendor = ohmd_device_list_intern(list, "OpenHMD");
+	desc->product = ohmd_device_list_intern(list, "HMD Null Device");
 
-	strcpy(desc->path, "(none)");
+	desc->path = ohmd_device_list_intern(list, "(none)");
 
 	desc->driver_ptr = driver;
 
@@ -138,13 +140,15 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 
 	// Left Controller
 	
-	desc = &list->devices[list->num_devices++];
+	desc = ohmd_device_list_add(list);
+	if(!desc)
+		return;
 
-	strcpy(desc->driver, "OpenHMD Null Driver");
-	strcpy(desc->vendor, "OpenHMD");
-	strcpy(desc->product, "Left Controller Null Device");
+	desc->driver = ohmd_device_list_intern(list, "OpenHMD Null Driver");
+	desc->vendor = ohmd_device_list_intern(list, "OpenHMD");
+	desc->product = ohmd_device_list_intern(list, "Left Controller Null Device");
 
-	strcpy(desc->path, "(none)");
+	desc->path = ohmd_device_list_intern(list, "(none)");
 
 	desc->driver_ptr = driver;
 
@@ -159,13 +163,15 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 	
 	// Right Controller
 	
-	desc = &list->devices[list->num_devices++];
+	desc = ohmd_device_list_add(list);
+	if(!desc)
+		return;
 
-	strcpy(desc->driver, "OpenHMD Null Driver");
-	strcpy(desc->vendor, "OpenHMD");
-	strcpy(desc->product, "Right Controller Null Device");
+	desc->driver = ohmd_device_list_intern(list, "OpenHMD Null Driver");
+	desc->vendor = ohmd_device_list_intern(list, "OpenHMD");
+	desc->product = ohmd_device_list_intern(list, "Right Controller Null Device");
 
-	strcpy(desc->path, "(none)");
+	desc->path = ohmd_device_list_intern(list, "(none)");
 
 	desc->driver_ptr = driver;
 
@@ -182,7 +188,7 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 static void destroy_driver(ohmd_driver* drv)
 {
 	LOGD("shutting down dummy driver");
-	free(drv);
+	ohmd_free(drv);
 }
 
 ohmd_driver* ohmd_create_dummy_drv(ohmd_context* ctx)
@@ -191,11 +197,10 @@ ohmd_driver* ohmd_create_dummy_drv(ohmd_context* ctx)
 	if(!drv)
 		return NULL;
 
-	drv->get_device_list = get_device_list;
-	drv->open_device = open_device;
 	drv->get_device_list = get_device_list;
 	drv->open_device = open_device;
 	drv->destroy = destroy_driver;
+	drv->ctx = ctx;
 
 	return drv;
 }
@@ -66,7 +66,7 @@ static int setf(ohmd_device* device, ohmd_float_value type, const float* in)
 static void close_device(ohmd_device* device)
 {
 	LOGD("closing external device");
-	free(device);
+	ohmd_free(device);
 }
 
 static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
@@ -106,13 +106,15 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 
 static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 {
-	ohmd_device_desc* desc = &list->devices[list->num_devices++];
+	ohmd_device_desc* desc = ohmd_device_list_add(list);
+	if(!desc)
+		return;
 
-	strcpy(desc->driver, "OpenHMD Generic External Driver");
-	strcpy(desc->vendor, "OpenHMD");
-	strcpy(desc->product, "External Device");
+	desc->driver = ohmd_device_list_intern(list, "OpenHMD Generic External Driver");
+	desc->vendor = ohmd_device_list_intern(list, "OpenHMD");
+	desc->product = ohmd_device_list_intern(list, "External Device");
 
-	strcpy(desc->path, "(none)");
+	desc->path = ohmd_device_list_intern(list, "(none)");
 		
 	desc->device_class = OHMD_DEVICE_CLASS_HMD;
 	desc->device_flags = OHMD_DEVICE_FLAGS_ROTATIONAL_TRACKING | OHMD_DEVICE_FLAGS_POSITIONAL_TRACKING;
@@ -123,7 +125,7 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 static void destroy_driver(ohmd_driver* drv)
 {
 	LOGD("shutting down external driver");
-	free(drv);
+	ohmd_free(drv);
 }
 
 ohmd_driver* ohmd_create_external_drv(ohmd_context* ctx)
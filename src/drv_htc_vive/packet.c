@@ -9,6 +9,9 @@
 /* HTC Vive Driver */
 
 
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include "vive.h"
 
 #include "../ext_deps/miniz.h"
@@ -69,77 +72,411 @@ bool vive_decode_sensor_packet(vive_headset_imu_packet* pkt,
 	return true;
 }
 
-//Trim function for removing tabs and spaces from string buffers
-static void trim(const char* src, char* buff, const unsigned int sizeBuff)
+#define VIVE_CONFIG_MAX_SIZE (1024 * 1024)
+
+// Inflates the zlib compressed config into a NUL terminated buffer that grows as
+// needed, rather than a fixed worst case one. Free the result with ohmd_free().
+static char* inflate_config(ohmd_context* ctx, const unsigned char* buffer, size_t size, size_t* out_size)
 {
-	if(sizeBuff < 1)
-		return;
+	// the decompressor state is around 11 KB, too much for small thread stacks
+	tinfl_decompressor* inflator = ohmd_alloc(ctx, sizeof(tinfl_decompressor));
+	if(!inflator)
+		return NULL;
+
+	tinfl_init(inflator);
+
+	// JSON usually compresses to around a quarter of its size
+	size_t capacity = size * 4 + 1;
+	unsigned char* out = ohmd_alloc(ctx, capacity);
+	size_t in_pos = 0, out_pos = 0;
+
+	while(out){
+		size_t in_bytes = size - in_pos;
+		size_t out_bytes = capacity - 1 - out_pos; // leave room for the terminator
+
+		tinfl_status status = tinfl_decompress(inflator, buffer + in_pos, &in_bytes,
+		                                       out, out + out_pos, &out_bytes,
+		                                       TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+		in_pos += in_bytes;
+		out_pos += out_bytes;
+
+		if(status == TINFL_STATUS_DONE){
+			out[out_pos] = '\0';
+			*out_size = out_pos;
+			ohmd_free(inflator);
+			return (char*)out;
+		}
+
+		if(status != TINFL_STATUS_HAS_MORE_OUTPUT || capacity >= VIVE_CONFIG_MAX_SIZE){
+			LOGE("invalid vive config, could not uncompress (status %d)", status);
+			break;
+		}
+
+		// the decompressor refers back into what it has already written, so grow the buffer in place
+		unsigned char* grown = ohmd_realloc(ctx, out, capacity * 2);
+		if(!grown)
+			break;
 
-	const char* current = src;
-	unsigned int i = 0;
-	while(*current != '\0' && i < sizeBuff-1)
-	{
-		if(*current != ' ' && *current != '\t' && *current != '\n')
-			buff[i++] = *current;
-		++current;
+		out = grown;
+		capacity *= 2;
 	}
-	buff[i] = '\0';
+
+	ohmd_free(out);
+	ohmd_free(inflator);
+	return NULL;
 }
 
-static void get_vec3f_from_json(const nx_json* json, const char* name, vec3f* result)
+// A minimal scanner for picking values out of the top level config object,
+// without building a tree for the rest of it.
+
+static const char* skip_space(const char* p, const char* end)
 {
-	const nx_json* acc_bias_arr = nx_json_get(json, name);
+	while(p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+		p++;
 
-	for (int i = 0; i < acc_bias_arr->length; i++) {
-		const nx_json* item = nx_json_item(acc_bias_arr, i);
-		result->arr[i] = (float) item->dbl_value;
+	return p;
+}
+
+static const char* skip_string(const char* p, const char* end)
+{
+	for(p++; p < end; p++){
+		if(*p == '\\')
+			p++;
+		else if(*p == '"')
+			return p + 1;
 	}
+
+	return NULL;
 }
 
-static void print_vec3f(const char* title, vec3f *vec)
+// Returns the end of the value starting at p, nested arrays and objects included
+static const char* skip_value(const char* p, const char* end)
 {
-	LOGI("%s = %f %f %f\n", title, vec->x, vec->y, vec->z);
+	int depth = 0;
+
+	while(p < end){
+		char c = *p;
+
+		if(c == '"'){
+			p = skip_string(p, end);
+			if(!p)
+				return NULL;
+		}else{
+			// a scalar ends at whatever follows it
+			if(depth == 0 && (c == ',' || c == ']' || c == '}'))
+				return p;
+
+			if(c == '[' || c == '{')
+				depth++;
+			else if(c == ']' || c == '}')
+				depth--;
+
+			p++;
+		}
+
+		if(depth == 0 && (c == '"' || c == ']' || c == '}'))
+			return p;
+	}
+
+	return depth == 0 ? p : NULL;
 }
 
-bool vive_decode_config_packet(vive_imu_config* result,
-                               const unsigned char* buffer,
-                               uint16_t size)
+// Sets values[i] to the start of the value for keys[i] in the top level object, or NULL if it
+// isn't there. Stops scanning once every key has been found. Returns the number found or -1.
+static int find_values(const char* json, size_t size, const char* const* keys, const char** values, int count)
 {
-	unsigned char output[32768];
-	mz_ulong output_size = 32768;
+	const char* end = json + size;
+	const char* p = skip_space(json, end);
+	int found = 0;
+
+	for(int i = 0; i < count; i++)
+		values[i] = NULL;
+
+	if(p == end || *p != '{')
+		return -1;
+
+	p = skip_space(p + 1, end);
+
+	while(p < end && *p == '"' && found < count){
+		const char* key = p + 1;
+		p = skip_string(p, end);
+		if(!p)
+			return -1;
 
-	int cmp_status = uncompress(output, &output_size,
-	                            buffer, (mz_ulong)size);
-	if (cmp_status != Z_OK){
-		LOGE("invalid vive config, could not uncompress");
+		size_t key_len = p - 1 - key;
+
+		p = skip_space(p, end);
+		if(p == end || *p != ':')
+			return -1;
+
+		const char* value = skip_space(p + 1, end);
+
+		for(int i = 0; i < count; i++){
+			if(!values[i] && strlen(keys[i]) == key_len && memcmp(keys[i], key, key_len) == 0){
+				values[i] = value;
+				found++;
+				break;
+			}
+		}
+
+		p = skip_value(value, end);
+		if(!p)
+			return -1;
+
+		p = skip_space(p, end);
+		if(p < end && *p == ',')
+			p = skip_space(p + 1, end);
+	}
+
+	return found;
+}
+
+// Reads a JSON number, returns the end of it or NULL. Unlike strtod this always uses '.'
+// as the decimal point, whatever the application set the locale to.
+static const char* read_number(const char* p, double* result)
+{
+	while(*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+		p++;
+
+	bool negative = *p == '-';
+	if(*p == '-' || *p == '+')
+		p++;
+
+	// digits past what a double holds only move the exponent
+	uint64_t mantissa = 0;
+	int exponent = 0, digits = 0;
+	for(; *p >= '0' && *p <= '9'; p++, digits++){
+		if(mantissa < UINT64_MAX / 10)
+			mantissa = mantissa * 10 + (*p - '0');
+		else
+			exponent++;
+	}
+
+	if(*p == '.'){
+		for(p++; *p >= '0' && *p <= '9'; p++, digits++){
+			if(mantissa < UINT64_MAX / 10){
+				mantissa = mantissa * 10 + (*p - '0');
+				exponent--;
+			}
+		}
+	}
+
+	if(digits == 0)
+		return NULL;
+
+	if(*p == 'e' || *p == 'E'){
+		const char* e = p + 1;
+		bool negative_exp = *e == '-';
+		if(*e == '-' || *e == '+')
+			e++;
+
+		if(*e >= '0' && *e <= '9'){
+			int value = 0;
+			for(; *e >= '0' && *e <= '9'; e++){
+				if(value < 10000)
+					value = value * 10 + (*e - '0');
+			}
+
+			exponent += negative_exp ? -value : value;
+			p = e;
+		}
+	}
+
+	*result = (negative ? -1.0 : 1.0) * (double)mantissa * pow(10.0, exponent);
+	return p;
+}
+
+// Reads a [x, y, z] array, the buffer must be NUL terminated
+static bool read_vec3f(const char* p, vec3f* result)
+{
+	if(!p || *p != '[')
 		return false;
+
+	p++;
+
+	for(int i = 0; i < 3; i++){
+		double value;
+		const char* num_end = read_number(p, &value);
+		if(!num_end)
+			return false;
+
+		result->arr[i] = (float)value;
+
+		p = num_end;
+		while(*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+			p++;
+
+		if(*p != (i < 2 ? ',' : ']'))
+			return false;
+
+		p++;
+	}
+
+	return true;
+}
+
+// Parses the object or array at value in place, the result lives in the arena
+static const nx_json* parse_value(char* value, const char* end, ohmd_arena* arena)
+{
+	char* value_end = (char*)skip_value(value, end);
+	if(!value_end)
+		return NULL;
+
+	// only safe once every value has been located, this overwrites the separator after it
+	*value_end = '\0';
+
+	nx_json_allocator allocator;
+	ohmd_arena_json_allocator(arena, &allocator);
+
+	return nx_json_parse_alloc(value, NULL, &allocator);
+}
+
+static void parse_distortion(const nx_json* json, vive_distortion* result)
+{
+	const nx_json* coeffs = nx_json_get(json, "coeffs");
+
+	result->center_x = (float)nx_json_get(json, "center_x")->dbl_value;
+	result->center_y = (float)nx_json_get(json, "center_y")->dbl_value;
+
+	for(int i = 0; i < 3; i++)
+		result->coeffs[i] = i < coeffs->length ? (float)nx_json_item(coeffs, i)->dbl_value : 0.0f;
+}
+
+static bool parse_eyes(const nx_json* json, vive_device_config* result)
+{
+	static const char* const channels[3] = { "distortion_red", "distortion", "distortion_blue" };
+
+	if(json->type != NX_JSON_ARRAY || json->length < 2)
+		return false;
+
+	for(int i = 0; i < 2; i++){
+		const nx_json* eye = nx_json_item(json, i);
+		vive_eye_config* out = &result->eyes[i];
+
+		if(nx_json_get(eye, "distortion")->type != NX_JSON_OBJECT)
+			return false;
+
+		for(int c = 0; c < 3; c++){
+			const nx_json* distortion = nx_json_get(eye, channels[c]);
+
+			// fall back to green for any channel that's missing
+			if(distortion->type != NX_JSON_OBJECT)
+				distortion = nx_json_get(eye, "distortion");
+
+			parse_distortion(distortion, &out->distortion[c]);
+		}
+
+		out->undistort_r2_cutoff = (float)nx_json_get(eye, "undistort_r2_cutoff")->dbl_value;
+	}
+
+	return true;
+}
+
+static void parse_sensors(const nx_json* json, vive_device_config* result)
+{
+	const nx_json* points = nx_json_get(json, "modelPoints");
+	const nx_json* normals = nx_json_get(json, "modelNormals");
+
+	int count = OHMD_MIN(points->length, VIVE_MAX_TRACKING_SENSORS);
+
+	if(points->length > VIVE_MAX_TRACKING_SENSORS)
+		LOGW("vive config has %d tracking sensors, only using %d", points->length, VIVE_MAX_TRACKING_SENSORS);
+
+	for(int i = 0; i < count; i++){
+		const nx_json* point = nx_json_item(points, i);
+		const nx_json* normal = nx_json_item(normals, i);
+
+		for(int j = 0; j < 3; j++){
+			result->sensors[i].position.arr[j] = (float)nx_json_item(point, j)->dbl_value;
+			result->sensors[i].normal.arr[j] = (float)nx_json_item(normal, j)->dbl_value;
+		}
+
+		// photodiodes, they don't blink
+		result->sensors[i].pattern = 0;
 	}
 
-	LOGD("Decompressed from %u to %u bytes\n",
-	     (mz_uint32)packet.length, (mz_uint32)output_size);
+	result->num_sensors = count;
+}
+
+static void print_vec3f(const char* title, vec3f *vec)
+{
+	LOGI("%s = %f %f %f\n", title, vec->x, vec->y, vec->z);
+}
 
-	trim((char*)output, (char*)output, (unsigned int)output_size);
+enum {
+	KEY_ACC_BIAS,
+	KEY_ACC_SCALE,
+	KEY_GYRO_BIAS,
+	KEY_GYRO_SCALE,
+	KEY_DEVICE,
+	KEY_EYE_TRANSFORMS,
+	KEY_LIGHTHOUSE,
+	KEY_COUNT
+};
 
-	const nx_json* json = nx_json_parse((char*)output, NULL);
+bool vive_decode_config_packet(ohmd_context* ctx,
+                               vive_imu_config* result,
+                               vive_device_config* device_config,
+                               const unsigned char* buffer,
+                               size_t size)
+{
+	size_t json_size;
+	char* json = inflate_config(ctx, buffer, size, &json_size);
+	if(!json)
+		return false;
 
-	if (json) {
-		get_vec3f_from_json(json, "acc_bias", &result->acc_bias);
-		get_vec3f_from_json(json, "acc_scale", &result->acc_scale);
-		get_vec3f_from_json(json, "gyro_bias", &result->gyro_bias);
-		get_vec3f_from_json(json, "gyro_scale", &result->gyro_scale);
+	LOGD("Decompressed from %u to %u bytes\n", (unsigned)size, (unsigned)json_size);
 
-		nx_json_free(json);
+	static const char* const keys[KEY_COUNT] = {
+		"acc_bias", "acc_scale", "gyro_bias", "gyro_scale",
+		"device", "tracking_to_eye_transform", "lighthouse_config"
+	};
+	vec3f* fields[] = { &result->acc_bias, &result->acc_scale, &result->gyro_bias, &result->gyro_scale };
+	const char* values[KEY_COUNT];
+	const char* json_end = json + json_size;
 
-		LOGI("\n--- Converted Vive JSON Data ---\n\n");
-		print_vec3f("acc_bias", &result->acc_bias);
-		print_vec3f("acc_scale", &result->acc_scale);
-		print_vec3f("gyro_bias", &result->gyro_bias);
-		print_vec3f("gyro_scale", &result->gyro_scale);
-		LOGI("\n--- End of Vive JSON Data ---\n\n");
-	} else {
+	if(find_values(json, json_size, keys, values, KEY_COUNT) < 0){
 		LOGE("Could not parse JSON data.\n");
+		ohmd_free(json);
 		return false;
 	}
 
+	for(int i = KEY_ACC_BIAS; i <= KEY_GYRO_SCALE; i++){
+		if(values[i] && !read_vec3f(values[i], fields[i]))
+			LOGW("invalid %s in vive config", keys[i]);
+	}
+
+	// the display and tracking sections are nested, parse just those
+	ohmd_arena arena;
+	ohmd_arena_init(&arena, ctx, 0);
+
+	const nx_json* device = values[KEY_DEVICE] ? parse_value((char*)values[KEY_DEVICE], json_end, &arena) : NULL;
+	const nx_json* eyes = values[KEY_EYE_TRANSFORMS] ? parse_value((char*)values[KEY_EYE_TRANSFORMS], json_end, &arena) : NULL;
+	const nx_json* lighthouse = values[KEY_LIGHTHOUSE] ? parse_value((char*)values[KEY_LIGHTHOUSE], json_end, &arena) : NULL;
+
+	if(device){
+		device_config->eye_width = (int)nx_json_get(device, "eye_target_width_in_pixels")->int_value;
+		device_config->eye_height = (int)nx_json_get(device, "eye_target_height_in_pixels")->int_value;
+	}
+
+	device_config->have_eyes = eyes && parse_eyes(eyes, device_config);
+	if(!device_config->have_eyes)
+		LOGW("no lens distortion in vive config");
+
+	if(lighthouse)
+		parse_sensors(lighthouse, device_config);
+
+	ohmd_arena_release(&arena);
+	ohmd_free(json);
+
+	LOGI("\n--- Converted Vive JSON Data ---\n\n");
+	print_vec3f("acc_bias", &result->acc_bias);
+	print_vec3f("acc_scale", &result->acc_scale);
+	print_vec3f("gyro_bias", &result->gyro_bias);
+	print_vec3f("gyro_scale", &result->gyro_scale);
+	LOGI("eye target size = %d x %d\n", device_config->eye_width, device_config->eye_height);
+	LOGI("tracking sensors = %d\n", device_config->num_sensors);
+	LOGI("\n--- End of Vive JSON Data ---\n\n");
+
 	return true;
 }
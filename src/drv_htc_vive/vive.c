@@ -46,6 +46,7 @@ typedef struct {
 	vec3f raw_accel, raw_gyro;
 	uint32_t last_ticks;
 	uint8_t last_seq;
+	bool have_seq;
 
 	vec3f gyro_error;
 	filter_queue gyro_q;
@@ -53,9 +54,23 @@ typedef struct {
 	vive_revision revision;
 
 	vive_imu_config imu_config;
+	vive_device_config config;
 
 } vive_priv;
 
+// Reading the config takes a few hundred feature reports, keep what's been read by serial number
+typedef struct vive_config_cache {
+	struct vive_config_cache* next;
+	char serial[64];
+	vive_imu_config imu_config;
+	vive_device_config config;
+} vive_config_cache;
+
+typedef struct {
+	ohmd_driver base;
+	vive_config_cache* config_cache;
+} vive_driver;
+
 static void vec3f_from_vive_vec_accel(const vive_imu_config* config,
                                       const int16_t* smp,
                                       vec3f* out)
@@ -92,35 +107,58 @@ static bool process_error(vive_priv* priv)
 	return false;
 }
 
-static vive_headset_imu_sample* get_next_sample(vive_headset_imu_packet* pkt,
-                                                int last_seq)
+// Each packet carries the last three samples from a ring buffer, so most of
+// them have been seen before. Orders the new ones by sequence number and
+// returns how many there are, along with how many were skipped over.
+static int sort_new_samples(const vive_headset_imu_packet* pkt, uint8_t last_seq, bool have_seq,
+                            const vive_headset_imu_sample** out, int* lost)
 {
-	int diff[3];
+	uint8_t diff[3];
+	int count = 0;
+
+	// without a previous sample, measure from half the counter range behind so the
+	// packet's samples sort correctly even across a wrap
+	if(!have_seq)
+		last_seq = pkt->samples[0].seq - 128;
 
 	for(int i = 0; i < 3; i++)
 	{
-		diff[i] = (int)pkt->samples[i].seq - last_seq;
-
-		if(diff[i] < -128){
-			diff[i] += 256;
+		// distance ahead of the last sample, wrapping with the 8-bit counter
+		uint8_t d = (uint8_t)(pkt->samples[i].seq - last_seq);
+
+		// repeats of samples we've already processed
+		if(have_seq && (d == 0 || d > 256 - 3))
+			continue;
+
+		// insertion sort, there are at most three, a sequence number
+		// repeated within the packet is only taken once
+		int j = count;
+		while(j > 0 && diff[j - 1] > d)
+			j--;
+		if(j > 0 && diff[j - 1] == d)
+			continue;
+
+		for(j = count++; j > 0 && diff[j - 1] > d; j--){
+			diff[j] = diff[j - 1];
+			out[j] = out[j - 1];
 		}
+
+		diff[j] = d;
+		out[j] = &pkt->samples[i];
 	}
 
-	int closest_diff = INT_MAX;
-	int closest_idx = -1;
+	*lost = 0;
 
-	for(int i = 0; i < 3; i++)
-	{
-		if(diff[i] < closest_diff && diff[i] > 0 && diff[i] < 128){
-			closest_diff = diff[i];
-			closest_idx = i;
-		}
-	}
+	if(count == 0 || !have_seq)
+		return count;
 
-	if(closest_idx != -1)
-		return pkt->samples + closest_idx;
+	if(diff[0] >= 128)
+		LOGW("large gap in IMU samples (last seq %u, got %u)", last_seq, out[0]->seq);
 
-	return NULL;
+	// every sequence number up to the newest one should have been seen
+	*lost = OHMD_MAX(diff[count - 1] - count, 0);
+
+	return count;
 }
 
 static void handle_imu_packet(vive_priv* priv, unsigned char *buffer, int size)
@@ -128,23 +166,30 @@ static void handle_imu_packet(vive_priv* priv, unsigned char *buffer, int size)
 	vive_headset_imu_packet pkt;
 	vive_decode_sensor_packet(&pkt, buffer, size);
 
-	vive_headset_imu_sample* smp = NULL;
+	const vive_headset_imu_sample* smp[3];
+	fusion_sample batch[3];
+	int lost;
 
-	while((smp = get_next_sample(&pkt, priv->last_seq)) != NULL)
+	int count = sort_new_samples(&pkt, priv->last_seq, priv->have_seq, smp, &lost);
+	int batch_size = 0;
+
+	for(int i = 0; i < count; i++)
 	{
 		if(priv->last_ticks == 0)
-			priv->last_ticks = smp->time_ticks;
+			priv->last_ticks = smp[i]->time_ticks;
 
 		uint32_t t1, t2;
-		t1 = smp->time_ticks;
+		t1 = smp[i]->time_ticks;
 		t2 = priv->last_ticks;
 
 		float dt = (t1 - t2) / VIVE_CLOCK_FREQ;
 
-		priv->last_ticks = smp->time_ticks;
+		priv->last_ticks = smp[i]->time_ticks;
+		priv->last_seq = smp[i]->seq;
+		priv->have_seq = true;
 
-		vec3f_from_vive_vec_accel(&priv->imu_config, smp->acc, &priv->raw_accel);
-		vec3f_from_vive_vec_gyro(&priv->imu_config, smp->rot, &priv->raw_gyro);
+		vec3f_from_vive_vec_accel(&priv->imu_config, smp[i]->acc, &priv->raw_accel);
+		vec3f_from_vive_vec_gyro(&priv->imu_config, smp[i]->rot, &priv->raw_gyro);
 
 		// Fix imu orientation
 		switch (priv->revision) {
@@ -165,16 +210,19 @@ static void handle_imu_packet(vive_priv* priv, unsigned char *buffer, int size)
 		}
 
 		if(process_error(priv)){
-			vec3f mag = {{0.0f, 0.0f, 0.0f}};
-			vec3f gyro;
-			ovec3f_subtract(&priv->raw_gyro, &priv->gyro_error, &gyro);
-
-			ofusion_update(&priv->sensor_fusion, dt,
-			               &gyro, &priv->raw_accel, &mag);
+			fusion_sample* out = &batch[batch_size++];
+			out->dt = dt;
+			out->accel = priv->raw_accel;
+			ovec3f_subtract(&priv->raw_gyro, &priv->gyro_error, &out->ang_vel);
 		}
+	}
 
-		priv->last_seq = smp->seq;
+	if(batch_size > 0){
+		vec3f mag = {{0.0f, 0.0f, 0.0f}};
+		ofusion_update_batch(&priv->sensor_fusion, batch, batch_size, &mag);
 	}
+
+	ohmd_add_sample_stats(&priv->base, count, lost);
 }
 
 static void update_device(ohmd_device* device)
@@ -258,7 +306,7 @@ static void close_device(ohmd_device* device)
 	hid_close(priv->hmd_handle);
 	hid_close(priv->imu_handle);
 
-	free(device);
+	ohmd_free(device);
 }
 
 #if 0
@@ -392,27 +440,189 @@ static int vive_read_config(vive_priv* priv)
 		.id = VIVE_CONFIG_READ_PACKET_ID,
 	};
 
-	unsigned char* packet_buffer = malloc(4096);
+	int capacity = 4096;
+	unsigned char* packet_buffer = ohmd_alloc(priv->base.ctx, capacity);
+	if (!packet_buffer)
+		return -1;
 
 	int offset = 0;
 	do {
 		bytes = hid_get_feature_report(priv->imu_handle,
 		                               (unsigned char*) &read_packet,
 		                               sizeof(read_packet));
+		if (bytes < 0) {
+			LOGE("Could not read vive config: %ls (%d)",
+			     hid_error(priv->imu_handle), bytes);
+			ohmd_free(packet_buffer);
+			return bytes;
+		}
+
+		if (read_packet.length > sizeof(read_packet.payload)) {
+			LOGE("invalid vive config packet length %u", read_packet.length);
+			ohmd_free(packet_buffer);
+			return -1;
+		}
+
+		if (offset + read_packet.length > capacity) {
+			unsigned char* grown = ohmd_realloc(priv->base.ctx, packet_buffer, capacity * 2);
+			if (!grown) {
+				ohmd_free(packet_buffer);
+				return -1;
+			}
+			packet_buffer = grown;
+			capacity *= 2;
+		}
 
 		memcpy((uint8_t*)packet_buffer + offset,
 		       &read_packet.payload,
 		       read_packet.length);
 		offset += read_packet.length;
 	} while (read_packet.length);
-	packet_buffer[offset] = '\0';
-	vive_decode_config_packet(&priv->imu_config, packet_buffer, offset);
 
-	free(packet_buffer);
+	bool decoded = vive_decode_config_packet(priv->base.ctx, &priv->imu_config,
+	                                         &priv->config, packet_buffer, offset);
+
+	ohmd_free(packet_buffer);
+
+	return decoded ? 0 : -1;
+}
+
+static int vive_load_config(vive_driver* drv, vive_priv* priv)
+{
+	wchar_t wserial[64] = {0};
+	char serial[64] = {0};
+
+	if (hid_get_serial_number_string(priv->hmd_handle, wserial, 63) == 0)
+		wcstombs(serial, wserial, sizeof(serial) - 1);
+
+	for (vive_config_cache* entry = drv->config_cache; entry && serial[0]; entry = entry->next) {
+		if (strcmp(entry->serial, serial) == 0) {
+			LOGI("Using cached config for %s", serial);
+			priv->imu_config = entry->imu_config;
+			priv->config = entry->config;
+			return 0;
+		}
+	}
+
+	int ret = vive_read_config(priv);
+	if (ret != 0 || !serial[0])
+		return ret;
+
+	vive_config_cache* entry = ohmd_alloc(drv->base.ctx, sizeof(vive_config_cache));
+	if (entry) {
+		strcpy(entry->serial, serial);
+		entry->imu_config = priv->imu_config;
+		entry->config = priv->config;
+		entry->next = drv->config_cache;
+		drv->config_cache = entry;
+	}
 
 	return 0;
 }
 
+// Vive lenses use a polynomial in r² that scales the source position by
+// 1 / (1 + k0 r² + k1 r⁴ + k2 r⁶), fit the PanoTools polynomial the universal
+// shader uses, d + c r + b r² + a r³, to it by least squares.
+static float vive_distortion_scale(const vive_distortion* d, float r)
+{
+	float r2 = r * r;
+	return 1.0f / (1.0f + r2 * (d->coeffs[0] + r2 * (d->coeffs[1] + r2 * d->coeffs[2])));
+}
+
+static void vive_fit_distortion(const vive_eye_config* eye, float k[4], float aberration[3])
+{
+	const int num_samples = 64;
+	const vive_distortion* green = &eye->distortion[1];
+
+	// fit up to where the factory calibration is valid, or the corners of the eye
+	float r_max = eye->undistort_r2_cutoff > 0 ? sqrtf(eye->undistort_r2_cutoff) : sqrtf(2.0f);
+
+	// normal equations for the coefficients of 1, r, r², r³
+	double m[4][5] = {{0}};
+	float channel_ratio[3] = {0, 0, 0};
+
+	for (int i = 0; i < num_samples; i++) {
+		float r = r_max * i / (num_samples - 1);
+		float scale = vive_distortion_scale(green, r);
+		double powers[4] = { 1.0, r, r * r, r * r * r };
+
+		for (int row = 0; row < 4; row++) {
+			for (int col = 0; col < 4; col++)
+				m[row][col] += powers[row] * powers[col];
+			m[row][4] += powers[row] * scale;
+		}
+
+		for (int c = 0; c < 3; c++)
+			channel_ratio[c] += vive_distortion_scale(&eye->distortion[c], r) / scale;
+	}
+
+	// gaussian elimination with partial pivoting
+	for (int col = 0; col < 4; col++) {
+		int pivot = col;
+		for (int row = col + 1; row < 4; row++)
+			if (fabs(m[row][col]) > fabs(m[pivot][col]))
+				pivot = row;
+
+		for (int j = 0; j < 5; j++) {
+			double tmp = m[col][j];
+			m[col][j] = m[pivot][j];
+			m[pivot][j] = tmp;
+		}
+
+		for (int row = col + 1; row < 4; row++) {
+			double f = m[row][col] / m[col][col];
+			for (int j = col; j < 5; j++)
+				m[row][j] -= f * m[col][j];
+		}
+	}
+
+	double coeffs[4];
+	for (int row = 3; row >= 0; row--) {
+		double v = m[row][4];
+		for (int j = row + 1; j < 4; j++)
+			v -= m[row][j] * coeffs[j];
+		coeffs[row] = v / m[row][row];
+	}
+
+	// PanoTools order is [a, b, c, d], highest power first
+	for (int i = 0; i < 4; i++)
+		k[i] = (float)coeffs[3 - i];
+
+	for (int c = 0; c < 3; c++)
+		aberration[c] = channel_ratio[c] / num_samples;
+}
+
+static void vive_apply_device_config(vive_priv* priv)
+{
+	ohmd_device_properties* props = &priv->base.properties;
+	const vive_device_config* config = &priv->config;
+
+	if (config->eye_width > 0 && config->eye_height > 0) {
+		props->hres = config->eye_width * 2;
+		props->vres = config->eye_height;
+		props->ratio = (float)config->eye_width / config->eye_height;
+	}
+
+	if (config->have_eyes) {
+		float k[4], aberration[3];
+		vive_fit_distortion(&config->eyes[0], k, aberration);
+
+		LOGI("Fitted distortion %f %f %f %f, aberration %f %f %f",
+		     k[0], k[1], k[2], k[3], aberration[0], aberration[1], aberration[2]);
+
+		ohmd_set_universal_distortion_k(props, k[0], k[1], k[2], k[3]);
+		ohmd_set_universal_aberration_k(props, aberration[0], aberration[1], aberration[2]);
+
+		// distortion centers are offsets from the middle of each eye's half of the screen
+		float left_x = config->eyes[0].distortion[1].center_x;
+		float right_x = config->eyes[1].distortion[1].center_x;
+		props->lens_sep = props->hsize / 2 + (right_x - left_x) * props->hsize / 4;
+	}
+
+	props->tracking_sensor_count = config->num_sensors;
+	props->tracking_sensors = config->sensors;
+}
+
 #define OHMD_GRAVITY_EARTH 9.80665 // m/s²
 
 static int vive_get_range_packet(vive_priv* priv)
@@ -569,7 +779,7 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 
 	switch (desc->revision) {
 		case REV_VIVE:
-			if (vive_read_config(priv) != 0)
+			if (vive_load_config((vive_driver*)driver, priv) != 0)
 			{
 				LOGW("Could not read config. Using defaults.\n");
 			}
@@ -638,6 +848,9 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 	priv->base.properties.lens_sep = 0.057863;
 	priv->base.properties.lens_vpos = 0.033896;
 
+	// replace the defaults with the factory calibration where there is one
+	vive_apply_device_config(priv);
+
 	float eye_to_screen_distance = 0.023226876441867737;
 	priv->base.properties.fov = 2 * atan2f(
 		priv->base.properties.hsize / 2 - priv->base.properties.lens_sep / 2,
@@ -659,7 +872,7 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 
 cleanup:
 	if(priv)
-		free(priv);
+		ohmd_free(priv);
 
 	return NULL;
 }
@@ -681,15 +894,19 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 
 	int idx = 0;
 	while (cur_dev) {
-		ohmd_device_desc* desc = &list->devices[list->num_devices++];
+		ohmd_device_desc* desc = ohmd_device_list_add(list);
+		if(!desc)
+			break;
 
-		strcpy(desc->driver, "OpenHMD HTC Vive Driver");
-		strcpy(desc->vendor, "HTC/Valve");
-		strcpy(desc->product, "HTC Vive");
+		desc->driver = ohmd_device_list_intern(list, "OpenHMD HTC Vive Driver");
+		desc->vendor = ohmd_device_list_intern(list, "HTC/Valve");
+		desc->product = ohmd_device_list_intern(list, "HTC Vive");
 
 		desc->revision = rev;
 
-		snprintf(desc->path, OHMD_STR_SIZE, "%d", idx);
+		char path[16];
+		snprintf(path, sizeof(path), "%d", idx);
+		desc->path = ohmd_device_list_intern(list, path);
 
 		desc->driver_ptr = driver;
 		desc->device_class = OHMD_DEVICE_CLASS_HMD;
@@ -704,17 +921,28 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 
 static void destroy_driver(ohmd_driver* drv)
 {
+	vive_driver* vive_drv = (vive_driver*)drv;
+
 	LOGD("shutting down HTC Vive driver");
-	free(drv);
+
+	vive_config_cache* entry = vive_drv->config_cache;
+	while(entry){
+		vive_config_cache* next = entry->next;
+		ohmd_free(entry);
+		entry = next;
+	}
+
+	ohmd_free(drv);
 }
 
 ohmd_driver* ohmd_create_htc_vive_drv(ohmd_context* ctx)
 {
-	ohmd_driver* drv = ohmd_alloc(ctx, sizeof(ohmd_driver));
+	vive_driver* vive_drv = ohmd_alloc(ctx, sizeof(vive_driver));
 
-	if(!drv)
+	if(!vive_drv)
 		return NULL;
 
+	ohmd_driver* drv = &vive_drv->base;
 	drv->get_device_list = get_device_list;
 	drv->open_device = open_device;
 	drv->destroy = destroy_driver;
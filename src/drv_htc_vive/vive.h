@@ -70,6 +70,32 @@ typedef struct
 	float gyro_range;
 } vive_imu_config;
 
+#define VIVE_MAX_TRACKING_SENSORS 32
+
+// DISTORT_DPOLY3 lens model for one colour channel, in eye coordinates normalised to [-1, 1]
+typedef struct
+{
+	float center_x, center_y;
+	float coeffs[3];
+} vive_distortion;
+
+typedef struct
+{
+	vive_distortion distortion[3]; // red, green, blue
+	float undistort_r2_cutoff;
+} vive_eye_config;
+
+// display and tracking calibration from the factory config
+typedef struct
+{
+	int eye_width, eye_height; // render target size for each eye in pixels
+	bool have_eyes;
+	vive_eye_config eyes[2]; // left, right
+
+	int num_sensors;
+	ohmd_tracking_sensor sensors[VIVE_MAX_TRACKING_SENSORS];
+} vive_device_config;
+
 #pragma pack(push,1)
 typedef struct
 {
@@ -93,8 +119,10 @@ void vec3f_from_vive_vec(const int16_t* smp, vec3f* out_vec);
 bool vive_decode_sensor_packet(vive_headset_imu_packet* pkt,
                                const unsigned char* buffer,
                                int size);
-bool vive_decode_config_packet(vive_imu_config* result,
+bool vive_decode_config_packet(ohmd_context* ctx,
+                               vive_imu_config* result,
+                               vive_device_config* device_config,
                                const unsigned char* buffer,
-                               uint16_t size);
+                               size_t size);
 
 #endif
@@ -21,7 +21,11 @@
 #define TICK_LEN (1.0f / 120000.0f) // 120 Hz ticks
 
 static const int controllerLength = 3 + (3+4)*2 + 2 + 2 + 1;
-static devices_t* nolo_devices;
+
+typedef struct {
+	ohmd_driver base;
+	nolo_kit* kits;
+} nolo_driver;
 
 static drv_priv* drv_priv_get(ohmd_device* device)
 {
@@ -76,22 +80,10 @@ static void update_device(ohmd_device* device)
 	if (priv->id != 0)
 		return;
 
-	devices_t* current = nolo_devices;
-	drv_priv* controller0 = NULL;
-	drv_priv* controller1 = NULL;
-
-	//Check if controllers exist
-	while (current != NULL) {
-		if (current->drv->hmd_tracker == priv)
-		{
-			if (current->drv->controller0)
-				controller0 = current->drv->controller0;
-			if (current->drv->controller1)
-				controller1 = current->drv->controller1;
-			break;
-		}
-		current = current->next;
-	}
+	// the update thread holds the context's update lock like open and close do, manual
+	// updates come from the application thread that opens and closes the devices
+	drv_priv* controller0 = priv->kit->controller0;
+	drv_priv* controller1 = priv->kit->controller1;
 
 	// Read all the messages from the device.
 	while(true){
@@ -192,29 +184,46 @@ static void close_device(ohmd_device* device)
 {
 	LOGD("closing device");
 	drv_priv* priv = drv_priv_get(device);
-	hid_close(priv->handle);
-	free(priv);
-}
+	nolo_kit* kit = priv->kit;
+
+	if (kit->hmd_tracker == priv)
+		kit->hmd_tracker = NULL;
+	else if (kit->controller0 == priv)
+		kit->controller0 = NULL;
+	else if (kit->controller1 == priv)
+		kit->controller1 = NULL;
+
+	// unlink and free the kit with its last device
+	if (!kit->hmd_tracker && !kit->controller0 && !kit->controller1) {
+		nolo_kit** link = kit->list;
+		while (*link != kit)
+			link = &(*link)->next;
+		*link = kit->next;
+		ohmd_free(kit);
+	}
 
-static void push_device(devices_t * head, drv_nolo* val) {
-	devices_t* current = head;
+	if (priv->handle)
+		hid_close(priv->handle);
+	ohmd_free(priv);
+}
 
-	if (!nolo_devices)
-	{
-		nolo_devices = calloc(1, sizeof(devices_t));
-		nolo_devices->drv = val;
-		nolo_devices->next = NULL;
-		return;
+static nolo_kit* get_kit(nolo_driver* driver, const char* path)
+{
+	for (nolo_kit* kit = driver->kits; kit; kit = kit->next) {
+		if (strcmp(kit->path, path) == 0)
+			return kit;
 	}
 
-	while (current->next != NULL) {
-		current = current->next;
-	}
+	nolo_kit* kit = ohmd_alloc(driver->base.ctx, sizeof(nolo_kit));
+	if (!kit)
+		return NULL;
+
+	snprintf(kit->path, sizeof(kit->path), "%s", path);
+	kit->list = &driver->kits;
+	kit->next = driver->kits;
+	driver->kits = kit;
 
-	/* now we can add a new variable */
-	current->next = calloc(1, sizeof(devices_t));
-	current->next->drv = val;
-	current->next->next = NULL;
+	return kit;
 }
 
 static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
@@ -247,32 +256,16 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 
 	}
 
-	devices_t* current = nolo_devices;
-	drv_nolo* mNOLO = NULL;
-
-	//Check if the opened device is part of a group
-	while (current != NULL) {
-		if (strcmp(current->drv->path, desc->path)==0)
-			mNOLO = current->drv;
-		current = current->next;
-	}
-
-	if (!mNOLO)
-	{
-		//Create new group
-		mNOLO = calloc(1, sizeof(drv_nolo));
-		mNOLO->hmd_tracker = NULL;
-		mNOLO->controller0 = NULL;
-		mNOLO->controller1 = NULL;
-		strcpy(mNOLO->path, desc->path);
-		push_device(nolo_devices, mNOLO);
-	}
+	// The devices of a kit share the tracker's path
+	priv->kit = get_kit((nolo_driver*)driver, desc->path);
+	if (!priv->kit)
+		goto cleanup;
 
 	if (priv->id == 0) {
-		mNOLO->hmd_tracker = priv;
+		priv->kit->hmd_tracker = priv;
 	}
 	else if (priv->id == 1) {
-		mNOLO->controller0 = priv;
+		priv->kit->controller0 = priv;
 		priv->base.properties.control_count = 8;
 		priv->base.properties.controls_hints[0] = OHMD_ANALOG_PRESS;
 		priv->base.properties.controls_hints[1] = OHMD_TRIGGER_CLICK;
@@ -292,7 +285,7 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 		priv->base.properties.controls_types[7] = OHMD_ANALOG;
 	}
 	else if (priv->id == 2) {
-		mNOLO->controller1 = priv;
+		priv->kit->controller1 = priv;
 		priv->base.properties.control_count = 8;
 		priv->base.properties.controls_hints[0] = OHMD_ANALOG_PRESS;
 		priv->base.properties.controls_hints[1] = OHMD_TRIGGER_CLICK;
@@ -325,8 +318,11 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 	return &priv->base;
 
 cleanup:
-	if(priv)
-		free(priv);
+	if(priv) {
+		if (priv->handle)
+			hid_close(priv->handle);
+		ohmd_free(priv);
+	}
 
 	return NULL;
 }
@@ -365,17 +361,20 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 		struct hid_device_info* devs = hid_enumerate(rd[i].vendor, rd[i].product);
 		struct hid_device_info* cur_dev = devs;
 
-		int id = 0;
 		while (cur_dev && is_nolo_device(cur_dev)) {
-			ohmd_device_desc* desc = &list->devices[list->num_devices++];
+			// ids are per kit, 0 is the tracker and 1 and 2 its controllers
+			int id = 0;
+			ohmd_device_desc* desc = ohmd_device_list_add(list);
+			if(!desc)
+				break;
 
-			strcpy(desc->driver, "OpenHMD NOLO VR CV1 driver");
-			strcpy(desc->vendor, "LYRobotix");
-			strcpy(desc->product, rd[i].name);
+			desc->driver = ohmd_device_list_intern(list, "OpenHMD NOLO VR CV1 driver");
+			desc->vendor = ohmd_device_list_intern(list, "LYRobotix");
+			desc->product = ohmd_device_list_intern(list, rd[i].name);
 
 			desc->revision = is_nolo_device(cur_dev);
 
-			strcpy(desc->path, cur_dev->path);
+			desc->path = ohmd_device_list_intern(list, cur_dev->path);
 
 			desc->device_flags = OHMD_DEVICE_FLAGS_POSITIONAL_TRACKING | OHMD_DEVICE_FLAGS_ROTATIONAL_TRACKING;
 			desc->device_class = OHMD_DEVICE_CLASS_HMD;
@@ -384,13 +383,15 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 			desc->id = id++;
 
 			//Controller 0
-			desc = &list->devices[list->num_devices++];
+			desc = ohmd_device_list_add(list);
+			if(!desc)
+				break;
 
-			strcpy(desc->driver, "OpenHMD NOLO VR CV1 driver");
-			strcpy(desc->vendor, "LYRobotix");
-			strcpy(desc->product, "NOLO CV1: Controller 0");
+			desc->driver = ohmd_device_list_intern(list, "OpenHMD NOLO VR CV1 driver");
+			desc->vendor = ohmd_device_list_intern(list, "LYRobotix");
+			desc->product = ohmd_device_list_intern(list, "NOLO CV1: Controller 0");
 
-			strcpy(desc->path, cur_dev->path);
+			desc->path = ohmd_device_list_intern(list, cur_dev->path);
 
 			desc->device_flags =
 				OHMD_DEVICE_FLAGS_POSITIONAL_TRACKING |
@@ -403,13 +404,15 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 			desc->id = id++;
 
 			// Controller 1
-			desc = &list->devices[list->num_devices++];
+			desc = ohmd_device_list_add(list);
+			if(!desc)
+				break;
 
-			strcpy(desc->driver, "OpenHMD NOLO VR CV1 driver");
-			strcpy(desc->vendor, "LYRobotix");
-			strcpy(desc->product, "NOLO CV1: Controller 1");
+			desc->driver = ohmd_device_list_intern(list, "OpenHMD NOLO VR CV1 driver");
+			desc->vendor = ohmd_device_list_intern(list, "LYRobotix");
+			desc->product = ohmd_device_list_intern(list, "NOLO CV1: Controller 1");
 
-			strcpy(desc->path, cur_dev->path);
+			desc->path = ohmd_device_list_intern(list, cur_dev->path);
 
 			desc->device_flags =
 				OHMD_DEVICE_FLAGS_POSITIONAL_TRACKING |
@@ -431,19 +434,19 @@ static void destroy_driver(ohmd_driver* drv)
 {
 	LOGD("shutting down NOLO CV1 driver");
 	hid_exit();
-	free(drv);
+	ohmd_free(drv);
 }
 
 ohmd_driver* ohmd_create_nolo_drv(ohmd_context* ctx)
 {
-	ohmd_driver* drv = ohmd_alloc(ctx, sizeof(ohmd_driver));
+	nolo_driver* drv = ohmd_alloc(ctx, sizeof(nolo_driver));
 	if(drv == NULL)
 		return NULL;
 
-	drv->get_device_list = get_device_list;
-	drv->open_device = open_device;
-	drv->destroy = destroy_driver;
-	drv->ctx = ctx;
+	drv->base.get_device_list = get_device_list;
+	drv->base.open_device = open_device;
+	drv->base.destroy = destroy_driver;
+	drv->base.ctx = ctx;
 
-	return drv;
+	return &drv->base;
 }
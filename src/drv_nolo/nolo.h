@@ -23,9 +23,12 @@ typedef struct
 	uint64_t tick;
 } nolo_sample;
 
+typedef struct nolo_kit nolo_kit;
+
 typedef struct {
 	ohmd_device base;
 
+	nolo_kit* kit;
 	hid_device* handle;
 	int id;
 	int rev;
@@ -46,17 +49,17 @@ typedef enum
 	NOLO_CONTROLLER_1_HMD_SMP2 = 17,
 } nolo_irq_cmd;
 
-typedef struct{
+// The open devices of one NOLO HMD tracker and its controllers, which all
+// arrive through the tracker's reports. NULL entries aren't open.
+struct nolo_kit {
 	char path[OHMD_STR_SIZE];
 	drv_priv* hmd_tracker;
 	drv_priv* controller0;
 	drv_priv* controller1;
-} drv_nolo;
 
-typedef struct devices{
-	drv_nolo* drv;
-	struct devices * next;
-} devices_t;
+	nolo_kit** list; // the driver's list of kits
+	nolo_kit* next;
+};
 
 void btea_decrypt(uint32_t *v, int n, int base_rounds, uint32_t const key[4]);
 void nolo_decrypt_data(unsigned char* buf);
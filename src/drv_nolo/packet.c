@@ -9,13 +9,19 @@
 
 
 #include <stdio.h>
+#include <string.h>
 #include "nolo.h"
 
 #define DELTA 0x9e3779b9
 #define MX (((z>>5^y<<2) + (y>>3^z<<4)) ^ ((sum^y) + (key[(p&3)^e] ^ z)))
 
-#define CRYPT_WORDS (64-4)/4
+#define CRYPT_WORDS ((64-4)/4)
 #define CRYPT_OFFSET 1
+#define CRYPT_ROUNDS (1 + 52/CRYPT_WORDS)
+
+#if defined(_WIN32) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define CRYPT_LITTLE_ENDIAN 1
+#endif
 
 inline static uint8_t read8(const unsigned char** buffer)
 {
@@ -61,12 +67,37 @@ void btea_decrypt(uint32_t *v, int n, int base_rounds, uint32_t const key[4])
 	} while (--rounds);
 }
 
-void nolo_decrypt_data(unsigned char* buf)
+// btea_decrypt() for the fixed report size and key, with the rounds and the key
+// selection known at compile time
+static void nolo_btea_decrypt(uint32_t* v)
 {
 	static const uint32_t key[4] = {0x875bcc51, 0xa7637a66, 0x50960967, 0xf8536c51};
+	uint32_t y = v[0], z, sum = CRYPT_ROUNDS*DELTA;
+
+	for (int r = 0; r < CRYPT_ROUNDS; r++) {
+		// key[(p&3)^e] for each p&3 this round
+		unsigned e = (sum >> 2) & 3;
+		const uint32_t k[4] = { key[e], key[1^e], key[2^e], key[3^e] };
+
+		for (int p = CRYPT_WORDS-1; p > 0; p--) {
+			z = v[p-1];
+			y = v[p] -= ((z>>5^y<<2) + (y>>3^z<<4)) ^ ((sum^y) + (k[p&3] ^ z));
+		}
+
+		z = v[CRYPT_WORDS-1];
+		y = v[0] -= ((z>>5^y<<2) + (y>>3^z<<4)) ^ ((sum^y) + (k[0] ^ z));
+		sum -= DELTA;
+	}
+}
+
+void nolo_decrypt_data(unsigned char* buf)
+{
 	uint32_t cryptpart[CRYPT_WORDS];
 
-	// Decrypt encrypted portion
+	// Decrypt encrypted portion, the words are little endian
+#ifdef CRYPT_LITTLE_ENDIAN
+	memcpy(cryptpart, buf + CRYPT_OFFSET, sizeof(cryptpart));
+#else
 	for (int i = 0; i < CRYPT_WORDS; i++) {
 	cryptpart[i] =
 		((uint32_t)buf[CRYPT_OFFSET+4*i  ]) << 0  |
@@ -74,15 +105,20 @@ void nolo_decrypt_data(unsigned char* buf)
 		((uint32_t)buf[CRYPT_OFFSET+4*i+2]) << 16 |
 		((uint32_t)buf[CRYPT_OFFSET+4*i+3]) << 24;
 	}
+#endif
 
-	btea_decrypt(cryptpart, CRYPT_WORDS, 1, key);
+	nolo_btea_decrypt(cryptpart);
 
+#ifdef CRYPT_LITTLE_ENDIAN
+	memcpy(buf + CRYPT_OFFSET, cryptpart, sizeof(cryptpart));
+#else
 	for (int i = 0; i < CRYPT_WORDS; i++) {
 		buf[CRYPT_OFFSET+4*i  ] = cryptpart[i] >> 0;
 		buf[CRYPT_OFFSET+4*i+1] = cryptpart[i] >> 8;
 		buf[CRYPT_OFFSET+4*i+2] = cryptpart[i] >> 16;
 		buf[CRYPT_OFFSET+4*i+3] = cryptpart[i] >> 24;
 	}
+#endif
 }
 
 void nolo_decode_position(const unsigned char* data, vec3f* pos)
@@ -150,9 +186,19 @@ void nolo_decode_quat_orientation(const unsigned char* data, quatf* quat)
 	quat->z = -j;
 }
 
+static void nolo_update_buttons(drv_priv* priv, uint8_t buttonstate)
+{
+	for (int bit = 0; bit < 6; bit++) {
+		float value = (buttonstate & 1<<bit ? 1 : 0);
+		if (priv->controller_values[bit] != value)
+			ohmd_push_control_event(&priv->base, bit, priv->controller_values[bit], value);
+		priv->controller_values[bit] = value;
+	}
+}
+
 void nolo_decode_controller(drv_priv* priv, const unsigned char* data)
 {
-	uint8_t bit, buttonstate;
+	uint8_t buttonstate;
 
 	vec3f position;
 	quatf orientation;
@@ -165,8 +211,7 @@ void nolo_decode_controller(drv_priv* priv, const unsigned char* data)
 
 		//Change button state
 		buttonstate = data[17];
-		for (bit=0; bit<6; bit++)
-			priv->controller_values[bit] = (buttonstate & 1<<bit ? 1 : 0);
+		nolo_update_buttons(priv, buttonstate);
 
 		priv->controller_values[6] = data[19]; //X Pad
 		priv->controller_values[7] = data[20]; //Y Pad
@@ -182,8 +227,7 @@ void nolo_decode_controller(drv_priv* priv, const unsigned char* data)
 		//Change button state
 		data += 12;
 		buttonstate = read8(&data);
-		for (bit=0; bit<6; bit++)
-			priv->controller_values[bit] = (buttonstate & 1<<bit ? 1 : 0);
+		nolo_update_buttons(priv, buttonstate);
 
 		priv->controller_values[6] = read8(&data); //X Pad
 		priv->controller_values[7] = read8(&data); //Y Pad
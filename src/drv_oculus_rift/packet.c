@@ -163,6 +163,7 @@ bool decode_tracker_sensor_msg_dk1(pkt_tracker_sensor* msg, const unsigned char*
 	buffer += 2; /* Skip unused last_command_id */
 	msg->temperature = READ16;
 
+	msg->samples_taken = msg->num_samples;
 	msg->num_samples = OHMD_MIN(msg->num_samples, 3);
 	for(int i = 0; i < msg->num_samples; i++){
 		decode_sample(buffer, msg->samples[i].accel);
@@ -207,6 +208,7 @@ bool decode_tracker_sensor_msg_dk2(pkt_tracker_sensor* msg, const unsigned char*
 
 	/* Second sample value is junk (outdated/uninitialized) value if
 	num_samples < 2. */
+	msg->samples_taken = msg->num_samples;
 	msg->num_samples = OHMD_MIN(msg->num_samples, 2);
 	for(int i = 0; i < msg->num_samples; i++){
 		decode_sample(buffer, msg->samples[i].accel);
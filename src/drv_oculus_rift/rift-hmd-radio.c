@@ -79,7 +79,7 @@ static int rift_radio_read_calibration_hash(hid_device *handle, uint8_t device_t
 	return rift_radio_read_flash(handle, device_type, 0x1bf0, 16, hash);
 }
 
-static int rift_radio_read_calibration(hid_device *handle, uint8_t device_type,
+static int rift_radio_read_calibration(ohmd_context *ctx, hid_device *handle, uint8_t device_type,
 		char **json_out, uint16_t *length)
 {
 	char *json;
@@ -96,7 +96,9 @@ static int rift_radio_read_calibration(hid_device *handle, uint8_t device_type,
 		return -1; /* Invalid data */
 	json_length = (flash_data[3] << 8) | flash_data[2];
 
-	json = calloc(1, json_length + 1);
+	json = ohmd_alloc(ctx, json_length + 1);
+	if (!json)
+		return -1;
 	memcpy(json, flash_data + 4, 16);
 
 	for (offset = 20; offset < json_length + 4; offset += 20) {
@@ -104,7 +106,7 @@ static int rift_radio_read_calibration(hid_device *handle, uint8_t device_type,
 
 		ret = rift_radio_read_flash(handle, device_type, offset, 20, flash_data);
 		if (ret < 0) {
-			free(json);
+			ohmd_free(json);
 			return ret;
 		}
 
@@ -131,16 +133,23 @@ static bool json_read_vec3(const nx_json *nxj, const char *key, vec3f *out)
 	return true;
 }
 
-static int rift_touch_parse_calibration(char *json,
+static int rift_touch_parse_calibration(ohmd_context *ctx, char *json,
 		rift_touch_calibration *c)
 {
 	const nx_json* nxj, *obj, *version, *array;
 	int version_number = -1;
 	unsigned int i;
+	ohmd_arena arena;
+	nx_json_allocator allocator;
+
+	ohmd_arena_init(&arena, ctx, 0);
+	ohmd_arena_json_allocator(&arena, &allocator);
 
-	nxj = nx_json_parse (json, NULL);
-	if (nxj == NULL)
+	nxj = nx_json_parse_alloc (json, NULL, &allocator);
+	if (nxj == NULL) {
+		ohmd_arena_release(&arena);
 		return -1;
+	}
 
 	obj = nx_json_get(nxj, "TrackedObject");
 	if (obj->type == NX_JSON_NULL)
@@ -191,43 +200,282 @@ static int rift_touch_parse_calibration(char *json,
 	for (i = 0; i < 8; i++)
 		c->cap_sense_touch[i] = nx_json_item (array, i)->int_value;
 
-	nx_json_free (nxj);
+	/* LED positions and normals, the first 6 values of each point */
+	c->num_leds = 0;
+	array = nx_json_get (obj, "ModelPoints");
+	for (const nx_json *point = array->child; point && c->num_leds < RIFT_TOUCH_MAX_LEDS; point = point->next) {
+		ohmd_tracking_sensor *led = &c->leds[c->num_leds];
+
+		if (point->type != NX_JSON_ARRAY || point->length < 6)
+			continue;
+
+		for (i = 0; i < 3; i++) {
+			led->position.arr[i] = nx_json_item (point, i)->dbl_value;
+			led->normal.arr[i] = nx_json_item (point, 3 + i)->dbl_value;
+		}
+		led->pattern = 0;
+		c->num_leds++;
+	}
+
+	ohmd_arena_release(&arena);
 	return 0;
 fail:
 	LOGW ("Unrecognised Touch Controller JSON data version %d\n%s\n", version_number, json);
-	nx_json_free (nxj);
+	ohmd_arena_release(&arena);
 	return -1;
 }
 
-int rift_touch_get_calibration(hid_device *handle, int device_id,
-		rift_touch_calibration *calibration)
+struct rift_touch_calibration_cache {
+	ohmd_context *ctx;
+	ohmd_mutex *lock;
+	struct rift_touch_calibration_cache_entry {
+		struct rift_touch_calibration_cache_entry *next;
+		uint8_t radio_address[5];
+		int device_id;
+		uint8_t hash[16];
+		rift_touch_calibration calibration;
+	} *entries;
+};
+
+typedef struct rift_touch_calibration_cache_entry rift_touch_calibration_cache_entry;
+
+rift_touch_calibration_cache *rift_touch_calibration_cache_new(ohmd_context *ctx)
+{
+	rift_touch_calibration_cache *cache = ohmd_alloc(ctx, sizeof(rift_touch_calibration_cache));
+	if (!cache)
+		return NULL;
+
+	cache->ctx = ctx;
+	cache->lock = ohmd_create_mutex(ctx);
+	if (!cache->lock) {
+		ohmd_free(cache);
+		return NULL;
+	}
+
+	return cache;
+}
+
+void rift_touch_calibration_cache_free(rift_touch_calibration_cache *cache)
+{
+	rift_touch_calibration_cache_entry *entry = cache->entries;
+
+	while (entry) {
+		rift_touch_calibration_cache_entry *next = entry->next;
+		ohmd_free(entry);
+		entry = next;
+	}
+
+	ohmd_destroy_mutex(cache->lock);
+	ohmd_free(cache);
+}
+
+static rift_touch_calibration_cache_entry *cache_find(rift_touch_calibration_cache *cache,
+		const uint8_t radio_address[5], int device_id)
+{
+	rift_touch_calibration_cache_entry *entry;
+
+	for (entry = cache->entries; entry; entry = entry->next) {
+		if (entry->device_id == device_id &&
+		    memcmp(entry->radio_address, radio_address, 5) == 0)
+			return entry;
+	}
+
+	return NULL;
+}
+
+/* Returns true and fills in calibration if the cache has it for this hash */
+static bool cache_lookup(rift_touch_calibration_cache *cache, const uint8_t radio_address[5],
+		int device_id, const uint8_t hash[16], rift_touch_calibration *calibration)
+{
+	rift_touch_calibration_cache_entry *entry;
+	bool found = false;
+
+	ohmd_lock_mutex(cache->lock);
+	entry = cache_find(cache, radio_address, device_id);
+	if (entry && memcmp(entry->hash, hash, 16) == 0) {
+		*calibration = entry->calibration;
+		found = true;
+	}
+	ohmd_unlock_mutex(cache->lock);
+
+	return found;
+}
+
+static void cache_store(rift_touch_calibration_cache *cache, const uint8_t radio_address[5],
+		int device_id, const uint8_t hash[16], const rift_touch_calibration *calibration)
+{
+	rift_touch_calibration_cache_entry *entry;
+
+	ohmd_lock_mutex(cache->lock);
+	entry = cache_find(cache, radio_address, device_id);
+	if (!entry) {
+		entry = ohmd_alloc(cache->ctx, sizeof(rift_touch_calibration_cache_entry));
+		if (entry) {
+			memcpy(entry->radio_address, radio_address, 5);
+			entry->device_id = device_id;
+			entry->next = cache->entries;
+			cache->entries = entry;
+		}
+	}
+	if (entry) {
+		memcpy(entry->hash, hash, 16);
+		entry->calibration = *calibration;
+	}
+	ohmd_unlock_mutex(cache->lock);
+}
+
+#define RIFT_RADIO_WORKER_MAX_REQUESTS 2
+
+/* Seconds before asking a controller that didn't answer again */
+#define RIFT_TOUCH_CALIBRATION_RETRY 1.0
+/* and before re-reading calibration we couldn't make sense of */
+#define RIFT_TOUCH_CALIBRATION_RETRY_BAD_DATA 30.0
+
+struct rift_radio_worker {
+	ohmd_context *ctx;
+	hid_device *handle;
+	uint8_t radio_address[5];
+	rift_touch_calibration_cache *cache;
+
+	ohmd_thread *thread;
+	ohmd_mutex *lock;
+	ohmd_cond *cond;
+
+	/* Protected by lock */
+	bool quit;
+	int num_requests;
+	rift_touch_controller_t *requests[RIFT_RADIO_WORKER_MAX_REQUESTS];
+};
+
+static void calibration_failed(rift_touch_controller_t *touch, double retry)
+{
+	touch->calibration_retry = ohmd_get_tick() + retry;
+	ohmd_atomic_store_u32(&touch->calibration_state, RIFT_TOUCH_CALIBRATION_FAILED);
+}
+
+static void fetch_touch_calibration(rift_radio_worker *worker, rift_touch_controller_t *touch)
 {
+	int device_id = touch->device_num;
 	uint8_t hash[16];
 	uint16_t length;
 	char *json = NULL;
-	int ret = -1;
 
 	/* If the controller isn't on yet, we might fail to read the calibration data */
-	ret = rift_radio_read_calibration_hash(handle, device_id, hash);
-	if (ret < 0) {
+	if (rift_radio_read_calibration_hash(worker->handle, device_id, hash) < 0) {
 		LOGV ("Failed to read calibration hash from device %d", device_id);
-		return ret;
+		calibration_failed(touch, RIFT_TOUCH_CALIBRATION_RETRY);
+		return;
 	}
 
-	/* TODO: We need a persistent store for the calibration data to
-	 * save time - we only need to re-read the calibration data from the
-	 * device if the hash changes. */
+	/* Only the hash needs reading if the controller has been seen before */
+	if (cache_lookup(worker->cache, worker->radio_address, device_id, hash, &touch->calibration)) {
+		LOGV ("Using cached calibration for device %d", device_id);
+		ohmd_atomic_store_u32(&touch->calibration_state, RIFT_TOUCH_CALIBRATION_READY);
+		return;
+	}
 
-	ret = rift_radio_read_calibration(handle, device_id, &json, &length);
-	if (ret < 0)
-		return ret;
+	if (rift_radio_read_calibration(worker->ctx, worker->handle, device_id, &json, &length) < 0) {
+		LOGV ("Failed to read calibration from device %d", device_id);
+		calibration_failed(touch, RIFT_TOUCH_CALIBRATION_RETRY);
+		return;
+	}
 
-	rift_touch_parse_calibration(json, calibration);
+	if (rift_touch_parse_calibration(worker->ctx, json, &touch->calibration) < 0) {
+		ohmd_free(json);
+		calibration_failed(touch, RIFT_TOUCH_CALIBRATION_RETRY_BAD_DATA);
+		return;
+	}
+	ohmd_free(json);
+
+	cache_store(worker->cache, worker->radio_address, device_id, hash, &touch->calibration);
+	ohmd_atomic_store_u32(&touch->calibration_state, RIFT_TOUCH_CALIBRATION_READY);
+}
+
+static unsigned int radio_worker_thread(void *arg)
+{
+	rift_radio_worker *worker = arg;
+
+	ohmd_lock_mutex(worker->lock);
+	while (!worker->quit) {
+		rift_touch_controller_t *touch;
+
+		if (worker->num_requests == 0) {
+			ohmd_cond_wait(worker->cond, worker->lock, 1.0);
+			continue;
+		}
+
+		touch = worker->requests[0];
+		worker->num_requests--;
+		memmove(worker->requests, worker->requests + 1, worker->num_requests * sizeof(touch));
+
+		/* The flash reads are slow, let more requests queue up meanwhile */
+		ohmd_unlock_mutex(worker->lock);
+		fetch_touch_calibration(worker, touch);
+		ohmd_lock_mutex(worker->lock);
+	}
+	ohmd_unlock_mutex(worker->lock);
 
-	free(json);
 	return 0;
 }
 
+rift_radio_worker *rift_radio_worker_new(ohmd_context *ctx, hid_device *handle,
+		const uint8_t radio_address[5], rift_touch_calibration_cache *cache)
+{
+	rift_radio_worker *worker = ohmd_alloc(ctx, sizeof(rift_radio_worker));
+	if (!worker)
+		return NULL;
+
+	worker->ctx = ctx;
+	worker->handle = handle;
+	memcpy(worker->radio_address, radio_address, 5);
+	worker->cache = cache;
+
+	worker->lock = ohmd_create_mutex(ctx);
+	worker->cond = ohmd_create_cond(ctx);
+	if (!worker->lock || !worker->cond)
+		goto fail;
+
+	worker->thread = ohmd_create_thread(ctx, radio_worker_thread, worker);
+	if (!worker->thread)
+		goto fail;
+
+	return worker;
+
+fail:
+	if (worker->cond)
+		ohmd_destroy_cond(worker->cond);
+	if (worker->lock)
+		ohmd_destroy_mutex(worker->lock);
+	ohmd_free(worker);
+	return NULL;
+}
+
+void rift_radio_worker_free(rift_radio_worker *worker)
+{
+	ohmd_lock_mutex(worker->lock);
+	worker->quit = true;
+	ohmd_cond_broadcast(worker->cond);
+	ohmd_unlock_mutex(worker->lock);
+
+	/* Waits for a fetch in progress to finish */
+	ohmd_destroy_thread(worker->thread);
+
+	ohmd_destroy_cond(worker->cond);
+	ohmd_destroy_mutex(worker->lock);
+	ohmd_free(worker);
+}
+
+void rift_radio_worker_request_calibration(rift_radio_worker *worker, rift_touch_controller_t *touch)
+{
+	ohmd_lock_mutex(worker->lock);
+	if (worker->num_requests < RIFT_RADIO_WORKER_MAX_REQUESTS) {
+		worker->requests[worker->num_requests++] = touch;
+		ohmd_atomic_store_u32(&touch->calibration_state, RIFT_TOUCH_CALIBRATION_PENDING);
+		ohmd_cond_broadcast(worker->cond);
+	}
+	ohmd_unlock_mutex(worker->lock);
+}
+
 bool rift_hmd_radio_get_address(hid_device *handle, uint8_t radio_address[5])
 {
 	unsigned char buf[FEATURE_BUFFER_SIZE];
@@ -10,8 +10,25 @@
 #include <hidapi.h>
 #include "rift.h"
 
-int rift_touch_get_calibration(hid_device *handle,
-		int device_id,
-		rift_touch_calibration *calibration);
+/* Touch calibration already read, kept by the driver so a controller
+ * seen before only needs its calibration hash checked */
+typedef struct rift_touch_calibration_cache rift_touch_calibration_cache;
+
+rift_touch_calibration_cache *rift_touch_calibration_cache_new(ohmd_context *ctx);
+void rift_touch_calibration_cache_free(rift_touch_calibration_cache *cache);
+
+/* Reads the touch controller calibration over the radio on a thread of
+ * its own, so the update path doesn't wait on the flash reads */
+typedef struct rift_radio_worker rift_radio_worker;
+
+rift_radio_worker *rift_radio_worker_new(ohmd_context *ctx, hid_device *handle,
+		const uint8_t radio_address[5], rift_touch_calibration_cache *cache);
+void rift_radio_worker_free(rift_radio_worker *worker);
+
+/* Queues a calibration read, the result is published through
+ * touch->calibration_state */
+void rift_radio_worker_request_calibration(rift_radio_worker *worker,
+		rift_touch_controller_t *touch);
+
 bool rift_hmd_radio_get_address(hid_device *handle, uint8_t address[5]);
 #endif /* RIFT_HMD_RADIO_H */
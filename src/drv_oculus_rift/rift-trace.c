@@ -0,0 +1,61 @@
+/*
+ * Oculus Rift HID report tracing
+ * Copyright 2026 OpenHMD contributors
+ * SPDX-License-Identifier:	BSL-1.0
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "rift-trace.h"
+
+/* Reports are small and frequent, let stdio batch them into large writes */
+#define TRACE_BUFFER_SIZE (64 * 1024)
+#define RECORD_HEADER_SIZE 12
+
+struct rift_trace_s {
+	FILE *file;
+	char buffer[TRACE_BUFFER_SIZE];
+};
+
+rift_trace *rift_trace_open(ohmd_context *ctx, const char *path)
+{
+	rift_trace *trace = ohmd_alloc(ctx, sizeof(rift_trace));
+	if (!trace)
+		return NULL;
+
+	trace->file = fopen(path, "wb");
+	if (!trace->file) {
+		LOGE("could not open trace file %s", path);
+		ohmd_free(trace);
+		return NULL;
+	}
+
+	setvbuf(trace->file, trace->buffer, _IOFBF, sizeof(trace->buffer));
+	fwrite(RIFT_TRACE_MAGIC, 1, 8, trace->file);
+
+	LOGI("tracing HID reports to %s", path);
+
+	return trace;
+}
+
+void rift_trace_report(rift_trace *trace, rift_trace_source source, uint64_t time_ns,
+		const unsigned char *buffer, int size)
+{
+	unsigned char header[RECORD_HEADER_SIZE];
+
+	for (int i = 0; i < 8; i++)
+		header[i] = (unsigned char)(time_ns >> (8 * i));
+	header[8] = (unsigned char)source;
+	header[9] = 0;
+	header[10] = (unsigned char)size;
+	header[11] = (unsigned char)(size >> 8);
+
+	fwrite(header, 1, sizeof(header), trace->file);
+	fwrite(buffer, 1, size, trace->file);
+}
+
+void rift_trace_close(rift_trace *trace)
+{
+	fclose(trace->file);
+	ohmd_free(trace);
+}
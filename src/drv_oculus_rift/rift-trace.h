@@ -0,0 +1,39 @@
+/*
+ * Oculus Rift HID report tracing
+ * Copyright 2026 OpenHMD contributors
+ * SPDX-License-Identifier:	BSL-1.0
+ */
+#ifndef RIFT_TRACE_H
+#define RIFT_TRACE_H
+
+#include <stdint.h>
+#include "rift.h"
+
+/*
+ * Setting OHMD_RIFT_TRACE to a file name when the HMD is opened records
+ * every raw HID report into that file. Tracing is off otherwise and costs
+ * the report path a NULL check.
+ *
+ * The file starts with the 8 byte magic RIFT_TRACE_MAGIC, followed by one
+ * record per report, all fields little endian:
+ *   uint64_t host time in nanoseconds (monotonic)
+ *   uint8_t  source (rift_trace_source)
+ *   uint8_t  reserved, 0
+ *   uint16_t report size
+ *   uint8_t  report[size]
+ */
+#define RIFT_TRACE_MAGIC "OHMDRTR1"
+#define RIFT_TRACE_ENV "OHMD_RIFT_TRACE"
+
+typedef enum {
+	RIFT_TRACE_HMD = 0,
+	RIFT_TRACE_RADIO = 1,
+} rift_trace_source;
+
+typedef struct rift_trace_s rift_trace;
+
+rift_trace *rift_trace_open(ohmd_context *ctx, const char *path);
+void rift_trace_report(rift_trace *trace, rift_trace_source source, uint64_t time_ns,
+		const unsigned char *buffer, int size);
+void rift_trace_close(rift_trace *trace);
+#endif /* RIFT_TRACE_H */
@@ -20,6 +20,7 @@
 
 #include "rift.h"
 #include "rift-hmd-radio.h"
+#include "rift-trace.h"
 #include "../hid.h"
 
 #define OHMD_GRAVITY_EARTH 9.80665 // m/s²
@@ -29,7 +30,9 @@
 #define SAMSUNG_ELECTRONICS_CO_ID 0x04e8
 #define RIFT_CV1_PID 0x0031
 
-#define TICK_LEN (1.0f / 1000.0f) // 1000 Hz ticks
+#define TICK_LEN (1.0f / 1000.0f) // nominal IMU sample period, 1000 Hz
+// reports further apart than this many packet intervals restart the IMU timing
+#define MAX_REPORT_GAP 100
 #define KEEP_ALIVE_VALUE (10 * 1000)
 #define SETFLAG(_s, _flag, _val) (_s) = ((_s) & ~(_flag)) | ((_val) ? (_flag) : 0)
 
@@ -39,12 +42,18 @@ struct rift_hmd_s {
 
 	hid_device* handle;
 	hid_device* radio_handle;
+	hid_device* radio_cmd_handle; // the radio worker's own, NULL if it shares radio_handle
+	rift_radio_worker *radio_worker;
 	pkt_sensor_range sensor_range;
 	pkt_sensor_display_info display_info;
 	rift_coordinate_frame coordinate_frame, hw_coordinate_frame;
 	pkt_sensor_config sensor_config;
 	pkt_tracker_sensor sensor;
+	rift_trace *trace; // NULL unless OHMD_RIFT_TRACE is set
+	bool imu_time_valid;
 	uint32_t last_imu_timestamp;
+	uint16_t last_sample_count; // total sample count after the last report
+	float sample_period; // measured IMU sample period in seconds
 	double last_keep_alive;
 	fusion sensor_fusion;
 	vec3f raw_mag, raw_accel, raw_gyro;
@@ -56,6 +65,7 @@ struct rift_hmd_s {
 	uint8_t radio_address[5];
 	rift_led *leds;
 	uint8_t num_leds;
+	ohmd_tracking_sensor *led_model; // leds in metres, for OHMD_TRACKING_SENSOR_MODEL
 
 	uint16_t remote_buttons_state;
 
@@ -80,6 +90,11 @@ typedef enum {
 	REV_GEARVR_GEN1
 } rift_revision;
 
+typedef struct {
+	ohmd_driver base;
+	rift_touch_calibration_cache* touch_cache;
+} rift_driver;
+
 typedef struct {
 	const char* name;
 	int company;
@@ -94,7 +109,7 @@ static device_list_t* rift_hmds;
 static hid_device* open_hid_dev (ohmd_context* ctx, int vid, int pid, int iface_num);
 static void close_hmd (rift_hmd_t *hmd);
 
-static rift_hmd_t *find_hmd(char *hid_path)
+static rift_hmd_t *find_hmd(const char *hid_path)
 {
 	device_list_t* current = rift_hmds;
 
@@ -108,14 +123,18 @@ static rift_hmd_t *find_hmd(char *hid_path)
 	return NULL;
 }
 
-static void push_hmd(rift_hmd_t *hmd, char *hid_path)
+static bool push_hmd(rift_hmd_t *hmd, const char *hid_path)
 {
-	device_list_t* d = calloc(1, sizeof(device_list_t));
+	device_list_t* d = ohmd_alloc(hmd->ctx, sizeof(device_list_t));
+	if (d == NULL)
+		return false;
+
 	d->hmd = hmd;
 	strcpy (d->path, hid_path);
 
 	d->next = rift_hmds;
 	rift_hmds = d;
+	return true;
 }
 
 static void release_hmd(rift_hmd_t *hmd)
@@ -139,7 +158,7 @@ static void release_hmd(rift_hmd_t *hmd)
 				rift_hmds = current->next;
 			else
 				prev->next = current->next;
-			free (current);
+			ohmd_free (current);
 			return;
 		}
 		prev = current;
@@ -211,28 +230,90 @@ static void handle_tracker_sensor_msg(rift_hmd_t* priv, unsigned char* buffer, i
 
 	pkt_tracker_sensor* s = &priv->sensor;
 
-	dump_packet_tracker_sensor(s);
-
 	int32_t mag32[] = { s->mag[0], s->mag[1], s->mag[2] };
 	vec3f_from_rift_vec(mag32, &priv->raw_mag);
 
-	// TODO: handle overflows in a nicer way
-	float dt = TICK_LEN; // TODO: query the Rift for the sample rate
-	if (s->timestamp > priv->last_imu_timestamp)
-	{
-		dt = (s->timestamp - priv->last_imu_timestamp) / 1000000.0f;
-		dt -= (s->num_samples - 1) * TICK_LEN; // TODO: query the Rift for the sample rate
+	if (s->num_samples == 0)
+		return;
+
+	// The timestamp is that of the newest sample, the DK1 has a 16 bit
+	// millisecond timestamp, later models a 32 bit microsecond one.
+	uint32_t elapsed_us;
+	uint16_t sample_count = s->total_sample_count + s->samples_taken;
+	int elapsed_samples;
+
+	if (buffer[0] == RIFT_IRQ_SENSORS_DK1) {
+		elapsed_us = (uint16_t)(s->timestamp / 1000 - priv->last_imu_timestamp / 1000) * 1000u;
+		elapsed_samples = s->samples_taken;
+	} else {
+		elapsed_us = s->timestamp - priv->last_imu_timestamp;
+		elapsed_samples = (uint16_t)(sample_count - priv->last_sample_count);
 	}
 
-	for(int i = 0; i < s->num_samples; i++){
-		vec3f_from_rift_vec(s->samples[i].accel, &priv->raw_accel);
-		vec3f_from_rift_vec(s->samples[i].gyro, &priv->raw_gyro);
+	// reports come every packet_interval + 1 IMU samples
+	float max_gap = (priv->sensor_config.packet_interval + 1) * MAX_REPORT_GAP * TICK_LEN;
+
+	fusion_sample samples[3];
+	float first_dt = priv->sample_period;
+	int lost = 0;
+
+	if (priv->imu_time_valid && elapsed_us > 0 && elapsed_samples >= s->num_samples &&
+	    elapsed_us * 1e-6f < max_gap) {
+		// measure the sample period, so the sum of the dts matches the elapsed time exactly
+		priv->sample_period = elapsed_us * 1e-6f / elapsed_samples;
+		first_dt = elapsed_us * 1e-6f - (s->num_samples - 1) * priv->sample_period;
+		lost = elapsed_samples - s->num_samples;
+	}
 
-		ofusion_update(&priv->sensor_fusion, dt, &priv->raw_gyro, &priv->raw_accel, &priv->raw_mag);
-		dt = TICK_LEN; // TODO: query the Rift for the sample rate
+	for(int i = 0; i < s->num_samples; i++){
+		vec3f_from_rift_vec(s->samples[i].accel, &samples[i].accel);
+		vec3f_from_rift_vec(s->samples[i].gyro, &samples[i].ang_vel);
+		samples[i].dt = i == 0 ? first_dt : priv->sample_period;
 	}
 
+	ofusion_update_batch(&priv->sensor_fusion, samples, s->num_samples, &priv->raw_mag);
+	ohmd_add_sample_stats(&priv->hmd_dev.base, s->num_samples, lost);
+
+	priv->raw_accel = samples[s->num_samples - 1].accel;
+	priv->raw_gyro = samples[s->num_samples - 1].ang_vel;
+
+	priv->imu_time_valid = true;
 	priv->last_imu_timestamp = s->timestamp;
+	priv->last_sample_count = sample_count;
+}
+
+/* Queue a control event for each of the first num_controls bits that changed */
+static void push_button_events(ohmd_device *dev, uint16_t old_buttons, uint16_t new_buttons, int num_controls)
+{
+	uint16_t changed = old_buttons ^ new_buttons;
+
+	for (int i = 0; i < num_controls; i++) {
+		if (changed & (1 << i))
+			ohmd_push_control_event(dev, i, (old_buttons >> i) & 1, (new_buttons >> i) & 1);
+	}
+}
+
+/* Fold the nominal scales and, once it is in, the calibration into one
+ * transform per sensor. The calibration is a row-major 3x3 matrix
+ * followed by the offsets, which apply before the matrix. */
+static void init_touch_imu_transform(rift_touch_controller_t *touch)
+{
+	static const float identity[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+	static const vec3f zero = {{ 0, 0, 0 }};
+	const float gyro_scale = 2.0f / 2048;
+	const float accel_scale = OHMD_GRAVITY_EARTH / 2048;
+	rift_touch_calibration *c = &touch->calibration;
+
+	if (touch->have_calibration) {
+		omat3x4f_init_rectify(&touch->gyro_transform, c->gyro_calibration, gyro_scale,
+				(const vec3f *)(c->gyro_calibration + 9));
+		omat3x4f_init_rectify(&touch->accel_transform, c->acc_calibration, accel_scale,
+				(const vec3f *)(c->acc_calibration + 9));
+	}
+	else {
+		omat3x4f_init_rectify(&touch->gyro_transform, identity, gyro_scale, &zero);
+		omat3x4f_init_rectify(&touch->accel_transform, identity, accel_scale, &zero);
+	}
 }
 
 static void handle_touch_controller_message(rift_hmd_t *hmd,
@@ -245,6 +326,9 @@ static void handle_touch_controller_message(rift_hmd_t *hmd,
 	if (touch->buttons != buttons) {
 		LOGV ("touch controller %d buttons now %x",
 				touch->base.id, buttons);
+		/* Button bits map directly onto control indices 0-3 */
+		if (touch->base.opened)
+			push_button_events (&touch->base.base, touch->buttons, buttons, 4);
 	}
 	touch->buttons = buttons;
 
@@ -254,11 +338,23 @@ static void handle_touch_controller_message(rift_hmd_t *hmd,
 		return;
 
 	if (!touch->have_calibration) {
-		/* We need calibration data to do any more */
-		if (rift_touch_get_calibration (hmd->radio_handle, touch->device_num,
-				&touch->calibration) < 0)
-			return;
-		touch->have_calibration = true;
+		/* The radio worker reads the calibration, until it arrives the
+		 * controller gets rotation only from the nominal scales */
+		uint32_t state = ohmd_atomic_load_u32(&touch->calibration_state);
+
+		if (state == RIFT_TOUCH_CALIBRATION_READY) {
+			touch->have_calibration = true;
+			init_touch_imu_transform(touch);
+
+			/* Published once, the update path runs with update_mutex held and
+			 * the core bounds the copies by the count the application saw */
+			touch->base.base.properties.tracking_sensors = touch->calibration.leds;
+			touch->base.base.properties.tracking_sensor_count = touch->calibration.num_leds;
+		}
+		else if (hmd->radio_worker && (state == RIFT_TOUCH_CALIBRATION_NONE ||
+		         (state == RIFT_TOUCH_CALIBRATION_FAILED && ohmd_get_tick() >= touch->calibration_retry))) {
+			rift_radio_worker_request_calibration (hmd->radio_worker, touch);
+		}
 	}
 
 	// time in microseconds
@@ -269,51 +365,21 @@ static void handle_touch_controller_message(rift_hmd_t *hmd,
 		dt = 0;
 
 	const double dt_s = 1e-6 * dt;
-	double a[3] = {
-		OHMD_GRAVITY_EARTH / 2048 * msg->touch.accel[0],
-		OHMD_GRAVITY_EARTH / 2048 * msg->touch.accel[1],
-		OHMD_GRAVITY_EARTH / 2048 * msg->touch.accel[2],
-	};
-	double g[3] = {
-		2.0 / 2048 * msg->touch.gyro[0],
-		2.0 / 2048 * msg->touch.gyro[1],
-		2.0 / 2048 * msg->touch.gyro[2],
-	};
 	vec3f mag = {{0.0f, 0.0f, 0.0f}};
-	vec3f gyro;
-	vec3f accel;
-
-	/* Apply correction offsets first - bottom row of the
-	 * calibration 3x4 matrix */
-	int i;
-	for (i = 0; i < 3; i++) {
-		a[i] -= c->acc_calibration[9 + i];
-		g[i] -= c->gyro_calibration[9 + i];
-	}
-	/* Then the 3x3 rotation matrix in row-major order */
-	accel.x = c->acc_calibration[0] * a[0] +
-			  c->acc_calibration[1] * a[1] +
-			  c->acc_calibration[2] * a[2];
-	accel.y = c->acc_calibration[3] * a[0] +
-			  c->acc_calibration[4] * a[1] +
-			  c->acc_calibration[5] * a[2];
-	accel.z = c->acc_calibration[6] * a[0] +
-			  c->acc_calibration[7] * a[1] +
-			  c->acc_calibration[8] * a[2];
-	gyro.x = c->gyro_calibration[0] * g[0] +
-			  c->gyro_calibration[1] * g[1] +
-			  c->gyro_calibration[2] * g[2];
-	gyro.y = c->gyro_calibration[3] * g[0] +
-			  c->gyro_calibration[4] * g[1] +
-			  c->gyro_calibration[5] * g[2];
-	gyro.z = c->gyro_calibration[6] * g[0] +
-			  c->gyro_calibration[7] * g[1] +
-			  c->gyro_calibration[8] * g[2];
+	vec3f gyro = {{ msg->touch.gyro[0], msg->touch.gyro[1], msg->touch.gyro[2] }};
+	vec3f accel = {{ msg->touch.accel[0], msg->touch.accel[1], msg->touch.accel[2] }};
+
+	omat3x4f_transform(&touch->gyro_transform, &gyro, &gyro, 1);
+	omat3x4f_transform(&touch->accel_transform, &accel, &accel, 1);
 
 	ofusion_update(&touch->imu_fusion, dt_s, &gyro, &accel, &mag);
 	touch->last_timestamp = msg->touch.timestamp;
 	touch->time_valid = true;
 
+	/* The analog controls need the calibrated ranges */
+	if (!touch->have_calibration)
+		return;
+
 	float t;
 	if (msg->touch.trigger < c->trigger_mid_range) {
 		t = 1.0f - ((float)msg->touch.trigger - c->trigger_min_range) /
@@ -387,6 +453,8 @@ static void handle_rift_radio_message(rift_hmd_t *hmd, pkt_rift_radio_message *m
 		case RIFT_REMOTE:
 			if (hmd->remote_buttons_state != msg->remote.buttons) {
 				LOGV ("Remote buttons state 0x%02x", msg->remote.buttons);
+				if (hmd->hmd_dev.opened)
+					push_button_events (&hmd->hmd_dev.base, hmd->remote_buttons_state, msg->remote.buttons, 9);
 			}
 			hmd->remote_buttons_state = msg->remote.buttons;
 			break;
@@ -412,6 +480,12 @@ static void handle_rift_radio_report(rift_hmd_t* hmd, unsigned char* buffer, int
 		handle_rift_radio_message(hmd, &r.message[1]);
 }
 
+static void trace_report(rift_hmd_t *priv, rift_trace_source source, const unsigned char *buffer, int size)
+{
+	uint64_t now = ohmd_monotonic_conv(ohmd_monotonic_get(priv->ctx), ohmd_monotonic_per_sec(priv->ctx), 1000000000);
+	rift_trace_report(priv->trace, source, now, buffer, size);
+}
+
 static void update_hmd(rift_hmd_t *priv)
 {
 	unsigned char buffer[FEATURE_BUFFER_SIZE];
@@ -439,6 +513,9 @@ static void update_hmd(rift_hmd_t *priv)
 			break; // No more messages, return.
 		}
 
+		if (priv->trace)
+			trace_report(priv, RIFT_TRACE_HMD, buffer, size);
+
 		// currently the only message type the hardware supports (I think)
 		if(buffer[0] == RIFT_IRQ_SENSORS_DK1 || buffer[0] == RIFT_IRQ_SENSORS_DK2) {
 			handle_tracker_sensor_msg(priv, buffer, size);
@@ -460,6 +537,9 @@ static void update_hmd(rift_hmd_t *priv)
 			break; // No more messages, return.
 		}
 
+		if (priv->trace)
+			trace_report(priv, RIFT_TRACE_RADIO, buffer, size);
+
 		if (buffer[0] == RIFT_RADIO_REPORT_ID)
 			handle_rift_radio_report (priv, buffer, size);
 	}
@@ -575,6 +655,24 @@ static int getf(ohmd_device* device, ohmd_float_value type, float* out)
 	return -1;
 }
 
+static int geti(ohmd_device* device, ohmd_int_value type, int* out)
+{
+	/* The exposure is shared by the HMD and the controllers it tracks */
+	rift_hmd_t *hmd = rift_device_priv_get(device)->hmd;
+
+	switch (type) {
+	case OHMD_TRACKING_EXPOSURE_INFO:
+		out[0] = hmd->sensor.exposure_count;
+		out[1] = (int)hmd->sensor.exposure_timestamp;
+		out[2] = (int)hmd->sensor.timestamp;
+		out[3] = hmd->sensor.led_pattern_phase;
+		return 0;
+
+	default:
+		return OHMD_S_INVALID_PARAMETER;
+	}
+}
+
 static void close_device(ohmd_device* device)
 {
 	LOGD("closing device");
@@ -605,7 +703,9 @@ static int rift_get_led_info(rift_hmd_t *priv)
 
 		if (first_index < 0) {
 			first_index = pos.index;
-			priv->leds = calloc(pos.num, sizeof(rift_led));
+			priv->leds = ohmd_alloc(priv->ctx, pos.num * sizeof(rift_led));
+			if (!priv->leds)
+				return -1;
 		}
 
 		if (pos.flags == 1) { //reports 0's
@@ -733,6 +833,7 @@ static void init_touch_device(rift_touch_controller_t *touch, int id, int device
 	touch->device_num = device_num;
 	ofusion_init(&touch->imu_fusion);
 	touch->time_valid = false;
+	init_touch_imu_transform(touch);
 
 	ohmd_set_default_device_properties(&ohmd_dev->properties);
 
@@ -776,7 +877,7 @@ static rift_hmd_t *open_hmd(ohmd_driver* driver, ohmd_device_desc* desc)
 	priv->use_count = 1;
 	priv->ctx = driver->ctx;
 
-	priv->last_imu_timestamp = -1;
+	priv->sample_period = TICK_LEN;
 
 	// Open the HID device
 	priv->handle = hid_open_path(desc->path);
@@ -795,6 +896,10 @@ static rift_hmd_t *open_hmd(ohmd_driver* driver, ohmd_device_desc* desc)
 		goto cleanup;
 	}
 
+	const char* trace_path = getenv(RIFT_TRACE_ENV);
+	if (trace_path && trace_path[0])
+		priv->trace = rift_trace_open(driver->ctx, trace_path);
+
 	/* For the CV1, try and open the radio HID device */
 	if (desc->revision == REV_CV1) {
 		priv->radio_handle = open_hid_dev (driver->ctx, OCULUS_VR_INC_ID, RIFT_CV1_PID, 1);
@@ -847,6 +952,19 @@ static rift_hmd_t *open_hmd(ohmd_driver* driver, ohmd_device_desc* desc)
 
 		/* Read the radio ID for CV1 to enable camera sensor sync */
 		rift_hmd_radio_get_address(priv->handle, priv->radio_address);
+
+		/* The touch calibration is read from a thread of its own, which
+		 * gets a handle of its own so reads and feature reports don't
+		 * share one hid_device between threads */
+		priv->radio_cmd_handle = open_hid_dev (driver->ctx, OCULUS_VR_INC_ID, RIFT_CV1_PID, 1);
+		if (priv->radio_cmd_handle == NULL)
+			LOGW("Could not open a second radio handle, sharing the first");
+
+		priv->radio_worker = rift_radio_worker_new (driver->ctx,
+				priv->radio_cmd_handle ? priv->radio_cmd_handle : priv->radio_handle,
+				priv->radio_address, ((rift_driver*)driver)->touch_cache);
+		if (priv->radio_worker == NULL)
+			LOGE("Failed to start the radio worker, touch controllers will stay uncalibrated");
 	}
 	else if (desc->revision == REV_DK2)
 	{
@@ -964,6 +1082,22 @@ static rift_hmd_t *open_hmd(ohmd_driver* driver, ohmd_device_desc* desc)
 	hmd_dev->id = 0;
 	hmd_dev->hmd = priv;
 
+	if (priv->num_leds > 0) {
+		priv->led_model = ohmd_alloc(driver->ctx, priv->num_leds * sizeof(ohmd_tracking_sensor));
+		if (!priv->led_model)
+			goto cleanup;
+
+		for (int i = 0; i < priv->num_leds; i++) {
+			for (int j = 0; j < 3; j++)
+				priv->led_model[i].position.arr[j] = priv->leds[i].pos.arr[j] * 1e-6f;
+			priv->led_model[i].normal = priv->leds[i].dir;
+			priv->led_model[i].pattern = priv->leds[i].pattern;
+		}
+
+		hmd_dev->base.properties.tracking_sensors = priv->led_model;
+		hmd_dev->base.properties.tracking_sensor_count = priv->num_leds;
+	}
+
 	// initialize sensor fusion
 	ofusion_init(&priv->sensor_fusion);
 
@@ -977,13 +1111,21 @@ cleanup:
 
 static void close_hmd(rift_hmd_t *hmd)
 {
-	if (hmd->leds)
-		free (hmd->leds);
+	if (hmd->radio_worker)
+		rift_radio_worker_free(hmd->radio_worker);
+	if (hmd->radio_cmd_handle)
+		hid_close(hmd->radio_cmd_handle);
+
+	ohmd_free(hmd->leds);
+	ohmd_free(hmd->led_model);
+
+	if (hmd->trace)
+		rift_trace_close(hmd->trace);
 
 	if (hmd->radio_handle)
 		hid_close(hmd->radio_handle);
 	hid_close(hmd->handle);
-	free(hmd);
+	ohmd_free(hmd);
 }
 
 /* FIXME: This opens the first device that matches the
@@ -1029,7 +1171,10 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 		hmd = open_hmd (driver, desc);
 		if (hmd == NULL)
 			return NULL;
-		push_hmd (hmd, desc->path);
+		if (!push_hmd (hmd, desc->path)) {
+			close_hmd (hmd);
+			return NULL;
+		}
 	}
 
 	if (desc->id == 0)
@@ -1052,6 +1197,7 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 	dev->base.update = update_device;
 	dev->base.close = close_device;
 	dev->base.getf = getf;
+	dev->base.geti = geti;
 
 	return &dev->base;
 }
@@ -1084,18 +1230,20 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 			if(ohmd_wstring_match(cur_dev->manufacturer_string, L"Oculus VR, Inc.") &&
 			   (rd[i].iface == -1 || cur_dev->interface_number == rd[i].iface)) {
 				int id = 0;
-				ohmd_device_desc* desc = &list->devices[list->num_devices++];
+				ohmd_device_desc* desc = ohmd_device_list_add(list);
+				if(!desc)
+					break;
 
-				strcpy(desc->driver, "OpenHMD Rift Driver");
-				strcpy(desc->vendor, "Oculus VR, Inc.");
-				strcpy(desc->product, rd[i].name);
+				desc->driver = ohmd_device_list_intern(list, "OpenHMD Rift Driver");
+				desc->vendor = ohmd_device_list_intern(list, "Oculus VR, Inc.");
+				desc->product = ohmd_device_list_intern(list, rd[i].name);
 
 				desc->revision = rd[i].rev;
 		
 				desc->device_class = OHMD_DEVICE_CLASS_HMD;
 				desc->device_flags = OHMD_DEVICE_FLAGS_ROTATIONAL_TRACKING;
 
-				strcpy(desc->path, cur_dev->path);
+				desc->path = ohmd_device_list_intern(list, cur_dev->path);
 
 				desc->driver_ptr = driver;
 				desc->id = id++;
@@ -1103,14 +1251,18 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 				/* For CV1, publish touch controllers */
 				if (desc->revision == REV_CV1) {
 					//Controller 0 (right)
-					desc = &list->devices[list->num_devices++];
+					desc = ohmd_device_list_add(list);
+					if(!desc)
+						break;
 					desc->revision = rd[i].rev;
 
-					strcpy(desc->driver, "OpenHMD Rift Driver");
-					strcpy(desc->vendor, "Oculus VR, Inc.");
-					sprintf(desc->product, "%s: Right Controller", rd[i].name);
+					desc->driver = ohmd_device_list_intern(list, "OpenHMD Rift Driver");
+					desc->vendor = ohmd_device_list_intern(list, "Oculus VR, Inc.");
+					char product[OHMD_STR_SIZE];
+					snprintf(product, OHMD_STR_SIZE, "%s: Right Controller", rd[i].name);
+					desc->product = ohmd_device_list_intern(list, product);
 
-					strcpy(desc->path, cur_dev->path);
+					desc->path = ohmd_device_list_intern(list, cur_dev->path);
 
 					desc->device_flags =
 						//OHMD_DEVICE_FLAGS_POSITIONAL_TRACKING |
@@ -1122,14 +1274,17 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 					desc->id = id++;
 
 					// Controller 1 (left)
-					desc = &list->devices[list->num_devices++];
+					desc = ohmd_device_list_add(list);
+					if(!desc)
+						break;
 					desc->revision = rd[i].rev;
 
-					strcpy(desc->driver, "OpenHMD Rift Driver");
-					strcpy(desc->vendor, "Oculus VR, Inc.");
-					sprintf(desc->product, "%s: Left Controller", rd[i].name);
+					desc->driver = ohmd_device_list_intern(list, "OpenHMD Rift Driver");
+					desc->vendor = ohmd_device_list_intern(list, "Oculus VR, Inc.");
+					snprintf(product, OHMD_STR_SIZE, "%s: Left Controller", rd[i].name);
+					desc->product = ohmd_device_list_intern(list, product);
 
-					strcpy(desc->path, cur_dev->path);
+					desc->path = ohmd_device_list_intern(list, cur_dev->path);
 
 					desc->device_flags =
 						//OHMD_DEVICE_FLAGS_POSITIONAL_TRACKING |
@@ -1150,21 +1305,32 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 
 static void destroy_driver(ohmd_driver* drv)
 {
+	rift_driver* rift_drv = (rift_driver*)drv;
+
 	LOGD("shutting down driver");
 	hid_exit();
-	free(drv);
+	rift_touch_calibration_cache_free(rift_drv->touch_cache);
+	ohmd_free(drv);
 
 	ohmd_toggle_ovr_service(1); //re-enable OVRService if previously running
 }
 
 ohmd_driver* ohmd_create_oculus_rift_drv(ohmd_context* ctx)
 {
-	ohmd_driver* drv = ohmd_alloc(ctx, sizeof(ohmd_driver));
-	if(drv == NULL)
+	rift_driver* rift_drv = ohmd_alloc(ctx, sizeof(rift_driver));
+	if(rift_drv == NULL)
 		return NULL;
 
+	rift_drv->touch_cache = rift_touch_calibration_cache_new(ctx);
+	if(rift_drv->touch_cache == NULL){
+		ohmd_free(rift_drv);
+		return NULL;
+	}
+
 	ohmd_toggle_ovr_service(0); //disable OVRService if running
 
+	ohmd_driver* drv = &rift_drv->base;
+
 	drv->get_device_list = get_device_list;
 	drv->open_device = open_device;
 	drv->destroy = destroy_driver;
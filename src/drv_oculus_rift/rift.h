@@ -95,7 +95,8 @@ typedef struct {
 } pkt_tracker_sample;
 
 typedef struct {
-	uint8_t num_samples;
+	uint8_t num_samples;         /* samples included in the report */
+	uint8_t samples_taken;       /* samples taken since the last report, the newest num_samples are included */
 	uint16_t total_sample_count;
 	int16_t temperature;
 	uint32_t timestamp;
@@ -174,8 +175,12 @@ typedef struct {
 	uint16_t pattern;
 } rift_led;
 
+#define RIFT_TOUCH_MAX_LEDS 64
+
 typedef struct {
 	vec3f imu_position;
+	int num_leds;
+	ohmd_tracking_sensor leds[RIFT_TOUCH_MAX_LEDS]; // in metres, patterns aren't known
 	float gyro_calibration[12];
 	float acc_calibration[12];
 	uint16_t joy_x_range_min;
@@ -197,6 +202,13 @@ typedef struct {
 	uint16_t cap_sense_touch[8];
 } rift_touch_calibration;
 
+typedef enum {
+	RIFT_TOUCH_CALIBRATION_NONE,	/* not asked for yet */
+	RIFT_TOUCH_CALIBRATION_PENDING,	/* queued on the radio worker */
+	RIFT_TOUCH_CALIBRATION_READY,
+	RIFT_TOUCH_CALIBRATION_FAILED	/* ask again after calibration_retry */
+} rift_touch_calibration_state;
+
 typedef struct rift_hmd_s rift_hmd_t;
 typedef struct rift_device_priv_s rift_device_priv;
 typedef struct rift_touch_controller_s rift_touch_controller_t;
@@ -215,8 +227,15 @@ struct rift_touch_controller_s {
 	int device_num;
 	fusion imu_fusion;
 
-	bool have_calibration;
+	/* calibration and calibration_retry are written by the radio worker
+	 * and only valid once calibration_state says so */
+	volatile uint32_t calibration_state;
+	double calibration_retry;
 	rift_touch_calibration calibration;
+	bool have_calibration;
+	/* raw samples to rad/s and m/s², nominal until the calibration is in */
+	mat3x4f gyro_transform;
+	mat3x4f accel_transform;
 
 	bool time_valid;
 	uint32_t last_timestamp;
@@ -99,14 +99,6 @@ print_controller_state (rift_s_controller_state *ctrl)
 }
 #endif
 
-static void
-vec3f_rotate_3x3(vec3f *vec, float rot[3][3])
-{
-	vec3f in = *vec;
-	for (int i = 0; i < 3; i++)
-		vec->arr[i] = rot[i][0] * in.arr[0] + rot[i][1] * in.arr[1] + rot[i][2] * in.arr[2];
-}
-
 static void
 handle_imu_update (rift_s_controller_state *ctrl, uint32_t imu_timestamp, const int16_t raw_accel[3], const int16_t raw_gyro[3])
 {
@@ -127,25 +119,11 @@ handle_imu_update (rift_s_controller_state *ctrl, uint32_t imu_timestamp, const
 
 	float dt_sec = dt / 1000000.0;
 
-	const float gyro_scale = ctrl->config.gyro_scale;
-	const float accel_scale = OHMD_GRAVITY_EARTH * ctrl->config.accel_scale;
-
-	ctrl->gyro.x = DEG_TO_RAD(gyro_scale * raw_gyro[0]);
-	ctrl->gyro.y = DEG_TO_RAD(gyro_scale * raw_gyro[1]);
-	ctrl->gyro.z = DEG_TO_RAD(gyro_scale * raw_gyro[2]);
+	ctrl->gyro = (vec3f){{ raw_gyro[0], raw_gyro[1], raw_gyro[2] }};
+	ctrl->accel = (vec3f){{ raw_accel[0], raw_accel[1], raw_accel[2] }};
 
-	ctrl->accel.x = accel_scale * raw_accel[0];
-	ctrl->accel.y = accel_scale * raw_accel[1];
-	ctrl->accel.z = accel_scale * raw_accel[2];
-
-	/* Apply correction offsets first, then rectify */
-	for (int j = 0; j < 3; j++) {
-		ctrl->accel.arr[j] -= ctrl->calibration.accel.offset.arr[j];
-		ctrl->gyro.arr[j] -= ctrl->calibration.gyro.offset.arr[j];
-	}
-
-	vec3f_rotate_3x3(&ctrl->accel, ctrl->calibration.accel.rectification);
-	vec3f_rotate_3x3(&ctrl->gyro, ctrl->calibration.gyro.rectification);
+	omat3x4f_transform(&ctrl->gyro_transform, &ctrl->gyro, &ctrl->gyro, 1);
+	omat3x4f_transform(&ctrl->accel_transform, &ctrl->accel, &ctrl->accel, 1);
 
 	ofusion_update(&ctrl->imu_fusion, dt_sec, &ctrl->gyro, &ctrl->accel, &ctrl->mag);
 #if 0
@@ -242,47 +220,166 @@ update_controller_state (rift_s_controller_state *ctrl, rift_s_controller_report
 	print_controller_state (ctrl);
 #endif
 
-	/* Finally, update and output the log */
-	if (report->flags & 0x04) {
-		/* New log line is starting, reset the counter */
-		ctrl->log_bytes = 0;
+	return true;
+}
+
+/* The firmware log arrives 3 characters per report, interleaved between
+ * the controllers. The reports only queue the characters, lines are put
+ * together and output by rift_s_controller_log_drain() */
+#define LOG_QUEUE_SIZE 256
+
+typedef struct {
+	uint8_t controller;
+	bool new_line;
+	bool have_bytes;
+	uint8_t bytes[3];
+} log_chunk;
+
+struct rift_s_controller_log_s {
+	log_chunk queue[LOG_QUEUE_SIZE];
+	int queue_head;
+	int queue_len;
+	unsigned int dropped;
+
+	int line_len[MAX_CONTROLLERS];
+	char line[MAX_CONTROLLERS][MAX_LOG_SIZE];
+};
+
+static void
+queue_log_bytes (rift_s_hmd_t *hmd, rift_s_controller_state *ctrl, rift_s_controller_report_t *report)
+{
+	/* 0x04 starts a new line, the parity bit toggles when there are new characters */
+	bool new_line = (report->flags & 0x04) != 0;
+	bool have_bytes = (ctrl->log_flags & 0x04) || (ctrl->log_flags & 0x02) != (report->flags & 0x02);
+
+	ctrl->log_flags = report->flags;
+
+	if (!new_line && !have_bytes)
+		return;
+
+	if (hmd->ctrl_log == NULL) {
+		hmd->ctrl_log = ohmd_alloc (hmd->ctx, sizeof(rift_s_controller_log));
+		if (hmd->ctrl_log == NULL)
+			return;
+	}
+
+	rift_s_controller_log *log = hmd->ctrl_log;
+
+	if (log->queue_len == LOG_QUEUE_SIZE) {
+		log->dropped++;
+		return;
 	}
 
-	if (ctrl->log_flags & 0x04 || (ctrl->log_flags & 0x02) != (report->flags & 0x02)) {
-		/* New log bytes in this report, collect them */
+	log_chunk *chunk = log->queue + (log->queue_head + log->queue_len) % LOG_QUEUE_SIZE;
+	chunk->controller = ctrl - hmd->controllers;
+	chunk->new_line = new_line;
+	chunk->have_bytes = have_bytes;
+	memcpy (chunk->bytes, report->log, sizeof(chunk->bytes));
+	log->queue_len++;
+}
+
+static void
+output_log_line (rift_s_hmd_t *hmd, int c)
+{
+	rift_s_controller_log *log = hmd->ctrl_log;
+
+	log->line[c][log->line_len[c]] = '\0';
+	LOGI ("Controller 0x%16" PRIx64 ": %s\n", hmd->controllers[c].device_id, log->line[c]);
+	log->line_len[c] = 0;
+}
+
+void
+rift_s_controller_log_drain (rift_s_hmd_t *hmd)
+{
+	rift_s_controller_log *log = hmd->ctrl_log;
+
+	if (log == NULL)
+		return;
+
+	if (log->dropped) {
+		LOGW ("Dropped %u controller log reports\n", log->dropped);
+		log->dropped = 0;
+	}
+
+	for (; log->queue_len > 0; log->queue_len--) {
+		log_chunk *chunk = log->queue + log->queue_head;
+		int c = chunk->controller;
+
+		log->queue_head = (log->queue_head + 1) % LOG_QUEUE_SIZE;
+
+		if (chunk->new_line)
+			log->line_len[c] = 0;
+
+		if (!chunk->have_bytes)
+			continue;
+
 		for (int i = 0; i < 3; i++) {
-			uint8_t c = report->log[i];
-			if (c != '\0') {
-				if (ctrl->log_bytes == (MAX_LOG_SIZE-1)) {
-					/* Log line got too long... output it */
-					ctrl->log[MAX_LOG_SIZE-1] = '\0';
-					LOGD("Controller: %s\n", ctrl->log);
-					ctrl->log_bytes = 0;
-				}
-				ctrl->log[ctrl->log_bytes++] = c;
+			if (chunk->bytes[i] != '\0') {
+				/* Output over-long lines in pieces */
+				if (log->line_len[c] == MAX_LOG_SIZE - 1)
+					output_log_line (hmd, c);
+				log->line[c][log->line_len[c]++] = chunk->bytes[i];
 			}
-			else if (ctrl->log_bytes > 0) {
-				/* Found the end of the string */
-				ctrl->log[ctrl->log_bytes] = '\0';
-				printf ("L	%s\n", ctrl->log);
-				ctrl->log_bytes = 0;
+			else if (log->line_len[c] > 0) {
+				output_log_line (hmd, c);
 			}
 		}
 	}
-	ctrl->log_flags = report->flags;
+}
 
-	return true;
+void
+rift_s_controller_log_free (rift_s_hmd_t *hmd)
+{
+	ohmd_free (hmd->ctrl_log);
+	hmd->ctrl_log = NULL;
 }
 
 #define READ_LE16(b) (b)[0]| ((b)[1]) << 8
 #define READ_LE32(b) (b)[0]| ((b)[1]) << 8 | ((b)[2]) << 16 | ((b)[3]) << 24
 #define READ_LEFLOAT32(b) (*(float *)(b));
 
+/* Button masks, in the order of the OHMD_CONTROLS_STATE digital controls */
+static const uint8_t button_masks[] = {
+	RIFT_S_BUTTON_A, RIFT_S_BUTTON_B, RIFT_S_BUTTON_OCULUS, RIFT_S_BUTTON_STICK
+};
+
+static void
+push_button_events (rift_s_hmd_t *hmd, int device_num, uint8_t old_buttons, uint8_t new_buttons)
+{
+	for (int d = 0; d < MAX_CONTROLLERS; d++) {
+		rift_s_controller_device *touch = hmd->touch_dev + d;
+
+		if (touch->device_num != device_num || !touch->base.opened)
+			continue;
+
+		for (int i = 0; i < 4; i++) {
+			uint8_t mask = button_masks[i];
+			if ((old_buttons ^ new_buttons) & mask)
+				ohmd_push_control_event (&touch->base.base, i, (old_buttons & mask) != 0, (new_buttons & mask) != 0);
+		}
+	}
+}
+
+/* Fold the scales, the offsets and the rectification into one
+ * transform per sensor, once both the config and calibration are in */
+static void
+update_imu_transform (rift_s_controller_state *ctrl)
+{
+	if (!ctrl->have_calibration || !ctrl->have_config)
+		return;
+
+	omat3x4f_init_rectify(&ctrl->gyro_transform, &ctrl->calibration.gyro.rectification[0][0],
+			DEG_TO_RAD(ctrl->config.gyro_scale), &ctrl->calibration.gyro.offset);
+	omat3x4f_init_rectify(&ctrl->accel_transform, &ctrl->calibration.accel.rectification[0][0],
+			OHMD_GRAVITY_EARTH * ctrl->config.accel_scale, &ctrl->calibration.accel.offset);
+}
+
 static void
 ctrl_config_cb (bool success, uint8_t *response_bytes, int response_bytes_len, rift_s_controller_state *ctrl)
 {
 	if (!success) {
 		LOGW("Failed to read controller config");
+		ctrl->config_requested = false;
 		return;
 	}
 
@@ -315,6 +412,7 @@ ctrl_config_cb (bool success, uint8_t *response_bytes, int response_bytes_len, r
 	ctrl->config.gyro_scale = READ_LEFLOAT32(response_bytes + 12);
 
 	ctrl->have_config = true;
+	update_imu_transform (ctrl);
 }
 
 static void
@@ -322,28 +420,56 @@ ctrl_json_cb (bool success, uint8_t *response_bytes, int response_bytes_len, rif
 {
 	if (!success) {
 		LOGW("Failed to read controller calibration block");
+		ctrl->calibration_requested = false;
 		return;
 	}
 
 	// LOGD ("Got Controller calibration:\n%s\n", response_bytes);
 
-	if (rift_s_controller_parse_imu_calibration((char *) response_bytes, &ctrl->calibration) == 0) {
+	if (rift_s_controller_parse_imu_calibration(ctrl->ctx, (char *) response_bytes, &ctrl->calibration) == 0) {
 		ctrl->have_calibration = true;
+		update_imu_transform (ctrl);
+		LOGI ("Controller 0x%16" PRIx64 " calibrated %.0f ms after it appeared\n", ctrl->device_id,
+				(ohmd_get_tick() - ctrl->seen_time) * 1000.0);
 	}
 	else {
 		LOGE ("Failed to parse controller configuration for controller 0x%16" PRIx64 "\n", ctrl->device_id);
 	}
 }
 
+/* Hand the LED model to the touch device once both the calibration
+ * and the device type are known. This runs from the update path with
+ * update_mutex held, and publishes the model only once */
+static void
+update_touch_led_model (rift_s_hmd_t *hmd, rift_s_controller_state *ctrl)
+{
+	int device_num = ctrl - hmd->controllers;
+
+	for (int i = 0; i < MAX_CONTROLLERS; i++) {
+		ohmd_device *dev = &hmd->touch_dev[i].base.base;
+
+		if (hmd->touch_dev[i].device_num != device_num || dev->properties.tracking_sensors != NULL)
+			continue;
+
+		dev->properties.tracking_sensors = ctrl->calibration.led_model;
+		dev->properties.tracking_sensor_count = ctrl->calibration.num_leds;
+		ctrl->led_model_published = true;
+	}
+}
+
 static void
 get_controller_configuration (rift_s_hmd_t *hmd, rift_s_controller_state *ctrl)
 {
   const uint8_t config_req[] = { 0x32, 0x20, 0xe8, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
 
-	rift_s_radio_queue_command (&hmd->radio_state, ctrl->device_id, config_req, sizeof(config_req),
-		(rift_s_radio_completion_fn) ctrl_config_cb, ctrl);
-	rift_s_radio_get_json_block (&hmd->radio_state, ctrl->device_id,
-		(rift_s_radio_completion_fn) ctrl_json_cb, ctrl);
+	if (!ctrl->config_requested) {
+		ctrl->config_requested = rift_s_radio_queue_command (&hmd->radio_state, ctrl->device_id,
+			config_req, sizeof(config_req), (rift_s_radio_completion_fn) ctrl_config_cb, ctrl);
+	}
+	if (!ctrl->calibration_requested) {
+		ctrl->calibration_requested = rift_s_radio_get_json_block (&hmd->radio_state, ctrl->device_id,
+			(rift_s_radio_completion_fn) ctrl_json_cb, ctrl);
+	}
 }
 
 void
@@ -382,17 +508,31 @@ rift_s_handle_controller_report (rift_s_hmd_t *hmd, hid_device *hid, const unsig
 		hmd->num_active_controllers++;
 
 		memset (ctrl, 0, sizeof (rift_s_controller_state));
+		ctrl->ctx = hmd->ctx;
 		ctrl->device_id = report.device_id;
+		ctrl->seen_time = ohmd_get_tick();
 		ofusion_init(&ctrl->imu_fusion);
 
 		update_device_types (hmd, hid);
-		get_controller_configuration (hmd, ctrl);
 	}
-
 	/* If we didn't already succeed in reading the type for this device, try again */
-	if (ctrl->device_type == 0x00)
+	else if (ctrl->device_type == 0x00)
 		update_device_types (hmd, hid);
 
+	/* Retry requests that failed or didn't fit in the radio queue */
+	if (!ctrl->config_requested || !ctrl->calibration_requested)
+		get_controller_configuration (hmd, ctrl);
+
+	uint8_t old_buttons = ctrl->buttons;
+
 	if (!update_controller_state (ctrl, &report))
 		rift_s_hexdump_buffer ("Invalid Controller Report Content", buf, size);
+	else
+		queue_log_bytes (hmd, ctrl, &report);
+
+	if (ctrl->buttons != old_buttons)
+		push_button_events (hmd, ctrl - hmd->controllers, old_buttons, ctrl->buttons);
+
+	if (ctrl->have_calibration && !ctrl->led_model_published)
+		update_touch_led_model (hmd, ctrl);
 }
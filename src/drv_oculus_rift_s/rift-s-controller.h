@@ -21,16 +21,14 @@ typedef struct {
 	float gyro_scale;
 } rift_s_controller_config;
 
+typedef struct rift_s_controller_log_s rift_s_controller_log;
+
 typedef struct {
+  ohmd_context *ctx;
+
   uint64_t device_id;
   uint32_t device_type;
-
-  /* 0x04 = new log line
-   * 0x02 = parity bit, toggles each line when receiving log chars 
-   * other bits, unknown */
-  uint8_t log_flags;
-  int log_bytes;
-  uint8_t log[MAX_LOG_SIZE];
+  double seen_time; /* when the first report arrived */
 
 	bool imu_time_valid;
   uint32_t imu_timestamp;
@@ -55,21 +53,39 @@ typedef struct {
   uint8_t capsense_joystick;
   uint8_t capsense_trigger;
 
-  uint8_t extra_bytes_len;
-  uint8_t extra_bytes[48];
+	/* Cleared when a request failed or couldn't be queued, so a later report retries it */
+	bool config_requested;
+	bool calibration_requested;
 
 	bool have_config;
 	rift_s_controller_config config;
 
 	bool have_calibration;
 	rift_s_controller_imu_calibration calibration;
+	bool led_model_published; /* handed to the touch device, never changed afterwards */
+	/* raw samples to rad/s and m/s², built once both of the above are in */
+	mat3x4f gyro_transform;
+	mat3x4f accel_transform;
 
   vec3f accel;
   vec3f gyro;
   vec3f mag;
 	fusion imu_fusion;
+
+  /* Rarely used, kept out of the way of the IMU state above */
+
+  /* 0x04 = new log line
+   * 0x02 = parity bit, toggles each line when receiving log chars 
+   * other bits, unknown */
+  uint8_t log_flags;
+
+  uint8_t extra_bytes_len;
+  uint8_t extra_bytes[48];
 } rift_s_controller_state;
 
 void rift_s_handle_controller_report (rift_s_hmd_t *hmd, hid_device *hid, const unsigned char *buf, int size);
+/* Output the complete controller firmware log lines queued by the reports */
+void rift_s_controller_log_drain (rift_s_hmd_t *hmd);
+void rift_s_controller_log_free (rift_s_hmd_t *hmd);
 
 #endif
@@ -72,15 +72,22 @@ static bool json_read_mat3x3(const nx_json *nxj, const char *key, float out[3][3
 	return true;
 }
 
-int rift_s_parse_imu_calibration(char *json,
+int rift_s_parse_imu_calibration(ohmd_context *ctx, char *json,
 		rift_s_imu_calibration *c)
 {
 	const nx_json* nxj, *obj, *version, *imu;
 	float version_number = -1;
+	ohmd_arena arena;
+	nx_json_allocator json_alloc;
 
-	nxj = nx_json_parse (json, 0);
-	if (nxj == NULL)
+	ohmd_arena_init (&arena, ctx, 0);
+	ohmd_arena_json_allocator (&arena, &json_alloc);
+
+	nxj = nx_json_parse_alloc (json, 0, &json_alloc);
+	if (nxj == NULL) {
+		ohmd_arena_release (&arena);
 		return -1;
+	}
 
 	obj = nx_json_get(nxj, "FileFormat");
 	if (obj->type == NX_JSON_NULL)
@@ -131,12 +138,129 @@ int rift_s_parse_imu_calibration(char *json,
 	if (!json_read_vec3(obj, "OffsetTemperatureCoefficient", &c->accel.temp_coeff))
 		goto fail;
 
-	nx_json_free (nxj);
+	ohmd_arena_release (&arena);
 	return 0;
 
 fail:
 	LOGW ("Unrecognised Rift S IMU Calibration JSON data. Version %f\n%s\n", version_number, json);
-	nx_json_free (nxj);
+	ohmd_arena_release (&arena);
+	return -1;
+}
+
+static bool json_read_floats(const nx_json *nxj, const char *key, float *out, int n)
+{
+	const nx_json *member = nx_json_get (nxj, key);
+
+	if (member->type != NX_JSON_ARRAY || member->length < n)
+		return false;
+
+	for (int i = 0; i < n; i++) {
+		const nx_json *item = nx_json_item (member, i);
+
+		if (item->type != NX_JSON_DOUBLE && item->type != NX_JSON_INTEGER)
+			return false;
+
+		out[i] = item->dbl_value;
+	}
+
+	return true;
+}
+
+/* Camera calibration JSON:
+ * { "CameraCalibration": [ {
+ *     "ImageSize": [ w, h ],
+ *     "T_DeviceFromCamera": [ 4x4 row-major, metres ],
+ *     "Intrinsics": {
+ *       "Projection": { "Type": "Pinhole", "Parameters": [ fx, fy, cx, cy ] },
+ *       "Distortion": { "Type": "Fisheye62", "Parameters": [ k1..k6, p2, p1 ] } } }, ... ] }
+ */
+static bool json_read_camera(const nx_json *camera, ohmd_camera_calibration *cam)
+{
+	const nx_json *intrinsics, *obj, *type;
+	float size[2], transform[16], params[8];
+
+	if (!json_read_floats (camera, "ImageSize", size, 2))
+		return false;
+	if (!json_read_floats (camera, "T_DeviceFromCamera", transform, 16))
+		return false;
+
+	intrinsics = nx_json_get (camera, "Intrinsics");
+	if (intrinsics->type != NX_JSON_OBJECT)
+		return false;
+
+	obj = nx_json_get (intrinsics, "Projection");
+	type = nx_json_get (obj, "Type");
+	if (type->type != NX_JSON_STRING || strcmp (type->text_value, "Pinhole"))
+		return false;
+	if (!json_read_floats (obj, "Parameters", params, 4))
+		return false;
+
+	cam->width = size[0];
+	cam->height = size[1];
+	cam->fx = params[0];
+	cam->fy = params[1];
+	cam->cx = params[2];
+	cam->cy = params[3];
+
+	obj = nx_json_get (intrinsics, "Distortion");
+	type = nx_json_get (obj, "Type");
+	if (type->type != NX_JSON_STRING || strcmp (type->text_value, "Fisheye62"))
+		return false;
+	if (!json_read_floats (obj, "Parameters", params, 8))
+		return false;
+
+	cam->model = OHMD_CAMERA_DISTORTION_FISHEYE62;
+	memcpy (cam->k, params, sizeof(cam->k));
+	cam->p[0] = params[7];
+	cam->p[1] = params[6];
+
+	for (int y = 0; y < 3; y++) {
+		for (int x = 0; x < 3; x++)
+			cam->rotation[y * 3 + x] = transform[y * 4 + x];
+		cam->translation.arr[y] = transform[y * 4 + 3];
+	}
+
+	return true;
+}
+
+int rift_s_parse_camera_calibration(ohmd_context *ctx, char *json,
+		ohmd_camera_calibration *cameras, int max_cameras)
+{
+	const nx_json* nxj, *array;
+	ohmd_arena arena;
+	nx_json_allocator json_alloc;
+	int n;
+
+	ohmd_arena_init (&arena, ctx, 0);
+	ohmd_arena_json_allocator (&arena, &json_alloc);
+
+	nxj = nx_json_parse_alloc (json, 0, &json_alloc);
+	if (nxj == NULL) {
+		ohmd_arena_release (&arena);
+		return -1;
+	}
+
+	array = nx_json_get (nxj, "CameraCalibration");
+	if (array->type != NX_JSON_ARRAY || array->length == 0)
+		goto fail;
+
+	n = array->length;
+	if (n > max_cameras) {
+		LOGW ("Rift S calibration has %d cameras, using the first %d", n, max_cameras);
+		n = max_cameras;
+	}
+
+	for (int i = 0; i < n; i++) {
+		if (!json_read_camera (nx_json_item (array, i), cameras + i))
+			goto fail;
+	}
+
+	ohmd_arena_release (&arena);
+	return n;
+
+fail:
+	LOGW ("Unrecognised Rift S Camera Calibration JSON data.\n%s\n", json);
+	ohmd_arena_release (&arena);
 	return -1;
 }
 
@@ -187,15 +311,22 @@ static bool json_read_lensing_model (const nx_json *lensing_model, rift_s_lensin
 	return true;
 }
 
-int rift_s_controller_parse_imu_calibration(char *json,
+int rift_s_controller_parse_imu_calibration(ohmd_context *ctx, char *json,
 		rift_s_controller_imu_calibration *c)
 {
 	const nx_json* nxj, *obj, *version, *leds;
 	int i;
+	ohmd_arena arena;
+	nx_json_allocator json_alloc;
 
-	nxj = nx_json_parse (json, 0);
-	if (nxj == NULL)
+	ohmd_arena_init (&arena, ctx, 0);
+	ohmd_arena_json_allocator (&arena, &json_alloc);
+
+	nxj = nx_json_parse_alloc (json, 0, &json_alloc);
+	if (nxj == NULL) {
+		ohmd_arena_release (&arena);
 		return -1;
+	}
 
 	obj = nx_json_get(nxj, "TrackedObject");
 	if (obj->type == NX_JSON_NULL)
@@ -225,19 +356,31 @@ int rift_s_controller_parse_imu_calibration(char *json,
 		goto fail;
 
 	c->num_leds = leds->length;
-	c->leds = calloc (c->num_leds, sizeof(rift_s_led));
+	c->leds = ohmd_alloc (ctx, c->num_leds * sizeof(rift_s_led));
+	if (c->leds == NULL)
+		goto fail;
 	for (i = 0; i < c->num_leds; i++) {
 		if (!json_read_led_point (leds, c->leds + i, i))
 			goto fail;
 	}
 
+	c->led_model = ohmd_alloc (ctx, c->num_leds * sizeof(ohmd_tracking_sensor));
+	if (c->led_model == NULL)
+		goto fail;
+	for (i = 0; i < c->num_leds; i++) {
+		c->led_model[i].position = c->leds[i].pos;
+		c->led_model[i].normal = c->leds[i].dir;
+	}
+
 	/* LED lensing models */
 	leds = nx_json_get (obj, "Lensing");
 	if (leds->type != NX_JSON_OBJECT)
 		goto fail;
 
 	c->num_lensing_models = leds->length;
-	c->lensing_models = calloc (c->num_lensing_models, sizeof(rift_s_lensing_model));
+	c->lensing_models = ohmd_alloc (ctx, c->num_lensing_models * sizeof(rift_s_lensing_model));
+	if (c->lensing_models == NULL)
+		goto fail;
 	for (i = 0; i < c->num_lensing_models; i++) {
 		if (!json_read_lensing_model (leds, c->lensing_models + i, i))
 			goto fail;
@@ -253,25 +396,30 @@ int rift_s_controller_parse_imu_calibration(char *json,
 	if (!json_read_vec3(nxj, "acc_b", &c->accel.offset))
 		goto fail;
 
-	nx_json_free (nxj);
+	ohmd_arena_release (&arena);
 	return 0;
 
 fail:
 	LOGW ("Unrecognised Rift S Controller Calibration JSON data.\n%s\n", json);
 	rift_s_controller_free_imu_calibration(c);
-	nx_json_free (nxj);
+	ohmd_arena_release (&arena);
 	return -1;
 }
 
 void rift_s_controller_free_imu_calibration(rift_s_controller_imu_calibration *c)
 {
+	if (c->led_model) {
+		ohmd_free (c->led_model);
+		c->led_model = NULL;
+	}
+
 	if (c->lensing_models) {
-		free (c->lensing_models);
+		ohmd_free (c->lensing_models);
 		c->lensing_models = NULL;
 	}
 
 	if (c->leds) {
-		free (c->leds);
+		ohmd_free (c->leds);
 		c->leds = NULL;
 	}
 }
@@ -14,10 +14,14 @@ typedef enum {
 		RIFT_S_FIRMWARE_BLOCK_THRESHOLD = 0xD,
 		RIFT_S_FIRMWARE_BLOCK_IMU_CALIB = 0xE,
 		RIFT_S_FIRMWARE_BLOCK_CAMERA_CALIB = 0xF,
+		/* The display colour and lens blocks have no known layout yet, so
+		 * they aren't read or exposed until they can be parsed */
 		RIFT_S_FIRMWARE_BLOCK_DISPLAY_COLOR_CALIB = 0x10,
 		RIFT_S_FIRMWARE_BLOCK_LENS_CALIB = 0x12
 } rift_s_firmware_block;
 
+#define RIFT_S_MAX_CAMERAS 5
+
 typedef struct {
 	mat4x4f imu_to_device_transform;
 
@@ -75,10 +79,15 @@ typedef struct {
 	/* Lensing models */
 	int num_lensing_models;
 	rift_s_lensing_model *lensing_models;
+
+	/* The LEDs for OHMD_TRACKING_SENSOR_MODEL */
+	ohmd_tracking_sensor *led_model;
 } rift_s_controller_imu_calibration;
 
-int rift_s_parse_imu_calibration(char *json, rift_s_imu_calibration *c);
-int rift_s_controller_parse_imu_calibration(char *json, rift_s_controller_imu_calibration *c);
+int rift_s_parse_imu_calibration(ohmd_context *ctx, char *json, rift_s_imu_calibration *c);
+/* Returns the number of cameras read into cameras, or -1 */
+int rift_s_parse_camera_calibration(ohmd_context *ctx, char *json, ohmd_camera_calibration *cameras, int max_cameras);
+int rift_s_controller_parse_imu_calibration(ohmd_context *ctx, char *json, rift_s_controller_imu_calibration *c);
 void rift_s_controller_free_imu_calibration(rift_s_controller_imu_calibration *c);
 
 #endif
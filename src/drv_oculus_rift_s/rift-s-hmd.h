@@ -27,6 +27,8 @@ struct rift_s_hmd_s {
 	int use_count;
 
 	hid_device* handles[3];
+	/* hidraw fds the input reports are read from, -1 to read the handle instead */
+	int input_fds[3];
 
 	uint32_t last_imu_timestamp;
 	double last_keep_alive;
@@ -39,13 +41,22 @@ struct rift_s_hmd_s {
 	rift_s_device_info_t device_info;
 	rift_s_imu_config_t imu_config;
 	rift_s_imu_calibration imu_calibration;
+	/* raw samples to rad/s and m/s², from the IMU config and calibration */
+	mat3x4f gyro_transform;
+	mat3x4f accel_transform;
+	/* Tracking camera calibration, for OHMD_CAMERA_CALIBRATION */
+	int num_cameras;
+	ohmd_camera_calibration cameras[RIFT_S_MAX_CAMERAS];
 
 	/* Controller state tracking */
 	int num_active_controllers;
 	rift_s_controller_state controllers[MAX_CONTROLLERS];
+	/* Controller firmware log, allocated when the first log characters arrive */
+	rift_s_controller_log *ctrl_log;
 
 	/* Radio comms manager */
   rift_s_radio_state radio_state;
+	double last_radio_poll;
 
 	/* OpenHMD output devices */
 	rift_s_device_priv hmd_dev;
@@ -173,16 +173,39 @@ static int get_feature_report(hid_device *hid, uint8_t cmd, uint8_t *buf, int le
 	return hid_get_feature_report(hid, (unsigned char *) buf, len);
 }
 
+/* Firmware chunk reads are answered after a device dependent delay. Poll
+ * around when the answer is expected and back off from there, instead of
+ * sleeping a fixed 2ms between polls */
+#define FW_READ_MIN_WAIT 0.0001
+#define FW_READ_MAX_WAIT 0.002
+#define FW_READ_TIMEOUT 0.1
+
+typedef struct {
+	double response_time; /* running average of how long a read takes to be answered */
+	int num_reads;
+	int num_polls;
+} fw_reader;
+
+struct rift_s_fw_block_cache {
+	rift_s_fw_block_cache *next;
+	uint8_t block_id;
+	uint64_t checksum;
+	uint32_t len;
+	char data[];
+};
+
 static int
-read_one_fw_block (hid_device *dev, uint8_t block_id, uint32_t pos, uint8_t read_len, uint8_t *buf)
+read_one_fw_block (fw_reader *reader, hid_device *dev, uint8_t block_id, uint32_t pos, uint8_t read_len, uint8_t *buf)
 {
 	unsigned char req[64] = { 0x4a, 0x00, };
-	int ret, loops = 0;
+	int ret;
 	bool send_req = true;
+	double start = ohmd_get_tick(), elapsed = 0.0;
+	double wait = FW_READ_MIN_WAIT;
 
 	req[2] = block_id;
 
-	do {
+	while (true) {
 		if (send_req) {
 			/* FIXME: Little-endian code: */
 			* (uint32_t *)(req + 3) = pos;
@@ -195,58 +218,92 @@ read_one_fw_block (hid_device *dev, uint8_t block_id, uint32_t pos, uint8_t read
 		}
 
 		ret = get_feature_report(dev, 0x4A, buf, 64);
+		reader->num_polls++;
 		if (ret < 0) {
 			LOGE("Report 74 GET failed");
 			return ret;
 		}
-		/* Loop until the result matches the address we asked for and
-		 * the 2nd byte == 0x00 (0x1 = busy or req ignored?), or 20 attempts have passed */
+
+		elapsed = ohmd_get_tick() - start;
+
+		/* Done when the result matches the address we asked for and
+		 * the 2nd byte == 0x00 (0x1 = busy or req ignored?) */
 		if (memcmp (req, buf, 7) == 0)
 			break;
 
+		if (elapsed >= FW_READ_TIMEOUT)
+			return -1;
+
 		/* Or if the 2nd byte of the return result is 0x1, the read is being processed,
 		 * don't send the req again. If it's 0x00, we seem to need to re-send the request	*/
 		send_req = (buf[1] == 0x00);
 
-		/* FIXME: Avoid the sleep and just try again later? */
-		ohmd_sleep (0.002);
-	} while (loops++ < 20);
+		/* Sleep until a bit before the answer is expected, so the estimate
+		 * can come down too, then poll at short intervals backing off */
+		if (elapsed < reader->response_time * 0.75) {
+			ohmd_sleep (OHMD_MAX (reader->response_time * 0.75 - elapsed, FW_READ_MIN_WAIT));
+		}
+		else {
+			ohmd_sleep (wait);
+			wait = OHMD_MIN (wait * 2, FW_READ_MAX_WAIT);
+		}
+	}
 
-	if (loops > 20)
-		return -1;
+	if (reader->num_reads++ == 0)
+		reader->response_time = elapsed;
+	else
+		reader->response_time += (elapsed - reader->response_time) / 8;
 
 	return ret;
 }
 
-int rift_s_read_firmware_block (hid_device *dev, uint8_t block_id,
-		char **data_out, int *len_out)
+static int
+read_fw_block (fw_reader *reader, ohmd_context *ctx, hid_device *dev, rift_s_fw_block_cache **cache,
+		rift_s_fw_block *block)
 {
 	uint32_t pos = 0x00, block_len;
 	unsigned char buf[64] = { 0x4a, 0x00, };
 	unsigned char *outbuf;
 	size_t total_read = 0;
+	uint8_t block_id = block->block_id;
 	int ret;
 
-	ret = read_one_fw_block (dev, block_id, 0, 0xC, buf);
+	block->data = NULL;
+	block->len = 0;
+
+	ret = read_one_fw_block (reader, dev, block_id, 0, 0xC, buf);
 	if (ret < 0) {
 		LOGE ("Failed to read fw block %02x header", block_id);
 		return ret;
 	}
 
 	/* The block header is 12 bytes. 8 byte checksum, 4 byte size? */
+	uint64_t checksum = *(uint64_t *)(buf + 8);
 	block_len = *(uint32_t *)(buf + 16);
 
 	if (block_len < 0xC || block_len == 0xFFFFFFFF)
 		return 0; /* Invalid block */
 
 #if 0
-	uint64_t checksum = *(uint64_t *)(buf + 8);
 	printf ("FW Block %02x Header. Checksum(?) %08lx len %d\n", block_id, checksum, block_len);
 #endif
 
 	/* Copy the contents of the fw block, minus the header */
-	outbuf = malloc (block_len + 1);
+	outbuf = ohmd_alloc (ctx, block_len + 1);
+	if (outbuf == NULL)
+		return -1;
 	outbuf[block_len] = 0;
+
+	/* Skip the reads if the block hasn't changed since it was last read */
+	for (rift_s_fw_block_cache *entry = cache ? *cache : NULL; entry; entry = entry->next) {
+		if (entry->block_id == block_id && entry->checksum == checksum && entry->len == block_len) {
+			memcpy (outbuf, entry->data, block_len);
+			block->data = (char *)(outbuf);
+			block->len = block_len;
+			return 1;
+		}
+	}
+
 	total_read = 0x0;
 
 	for (pos = 0x0; pos < block_len; pos += 56) {
@@ -254,10 +311,10 @@ int rift_s_read_firmware_block (hid_device *dev, uint8_t block_id,
 		if (pos + read_len > block_len)
 			read_len = block_len - pos;
 
-		ret = read_one_fw_block (dev, block_id, pos + 0xC, read_len, buf);
+		ret = read_one_fw_block (reader, dev, block_id, pos + 0xC, read_len, buf);
 		if (ret < 0) {
 			LOGE("Failed to read fw block %02x at pos 0x%08x len %d", block_id, pos, read_len);
-			free(outbuf);
+			ohmd_free(outbuf);
 			return ret;
 		}
 		memcpy (outbuf + total_read, buf + 8, read_len);
@@ -268,7 +325,7 @@ int rift_s_read_firmware_block (hid_device *dev, uint8_t block_id,
 		if (total_read < block_len) {
 			LOGE ("Short FW read - only read %u bytes of %u",
 				 (unsigned int) total_read, block_len);
-			free(outbuf);
+			ohmd_free(outbuf);
 			return -1;
 		}
 
@@ -282,10 +339,70 @@ int rift_s_read_firmware_block (hid_device *dev, uint8_t block_id,
 #endif
 	}
 
-	*data_out = (char *)(outbuf);
-	*len_out = block_len;
+	if (cache) {
+		rift_s_fw_block_cache *entry = ohmd_alloc (ctx, sizeof (rift_s_fw_block_cache) + block_len);
+		if (entry) {
+			entry->block_id = block_id;
+			entry->checksum = checksum;
+			entry->len = block_len;
+			memcpy (entry->data, outbuf, block_len);
 
-	return ret;
+			entry->next = *cache;
+			*cache = entry;
+		}
+	}
+
+	block->data = (char *)(outbuf);
+	block->len = block_len;
+
+	return 0;
+}
+
+int rift_s_read_firmware_blocks (ohmd_context *ctx, hid_device *dev, rift_s_fw_block_cache **cache,
+		rift_s_fw_block *blocks, int num_blocks)
+{
+	fw_reader reader = { 0, };
+	double start = ohmd_get_tick();
+	int num_cached = 0, num_failed = 0;
+
+	/* One reader for all of them, a block that fails doesn't stop the rest */
+	for (int i = 0; i < num_blocks; i++) {
+		blocks[i].result = read_fw_block (&reader, ctx, dev, cache, blocks + i);
+		if (blocks[i].result < 0)
+			num_failed++;
+		else if (blocks[i].result == 1)
+			num_cached++;
+	}
+
+	LOGI ("Read %d fw blocks (%d cached, %d failed) in %.1f ms, %d chunks, %d polls, response time %.2f ms",
+			num_blocks, num_cached, num_failed, (ohmd_get_tick() - start) * 1000.0,
+			reader.num_reads, reader.num_polls, reader.response_time * 1000.0);
+
+	return num_failed;
+}
+
+int rift_s_read_firmware_block (ohmd_context *ctx, hid_device *dev, uint8_t block_id,
+		char **data_out, int *len_out)
+{
+	rift_s_fw_block block = { .block_id = block_id };
+
+	rift_s_read_firmware_blocks (ctx, dev, NULL, &block, 1);
+	if (block.result < 0)
+		return block.result;
+
+	*data_out = block.data;
+	*len_out = block.len;
+
+	return 0;
+}
+
+void rift_s_fw_block_cache_free (rift_s_fw_block_cache *cache)
+{
+	while (cache) {
+		rift_s_fw_block_cache *next = cache->next;
+		ohmd_free (cache);
+		cache = next;
+	}
 }
 
 void
@@ -215,7 +215,25 @@ int rift_s_set_screen_enable (hid_device *hid, bool enable);
 void rift_s_send_keepalive (hid_device *hid);
 bool rift_s_parse_hmd_report (rift_s_hmd_report_t *report, const unsigned char *buf, int size);
 bool rift_s_parse_controller_report (rift_s_controller_report_t *report, const unsigned char *buf, int size);
-int rift_s_read_firmware_block (hid_device *handle, uint8_t block_id, char **data_out, int *len_out);
+int rift_s_read_firmware_block (ohmd_context *ctx, hid_device *handle, uint8_t block_id, char **data_out, int *len_out);
+
+/* Firmware blocks already read, by block id and the checksum in their 12
+ * byte header. The driver keeps it so reopening the HMD skips the reads */
+typedef struct rift_s_fw_block_cache rift_s_fw_block_cache;
+void rift_s_fw_block_cache_free (rift_s_fw_block_cache *cache);
+
+typedef struct {
+	uint8_t block_id;
+	char *data; /* ohmd_alloc()ed and 0 terminated, NULL if the block is invalid */
+	int len;
+	int result; /* < 0 if reading the block failed, data is NULL then */
+} rift_s_fw_block;
+
+/* Reads several blocks in one go, so the read timing learnt on the first
+ * carries over to the rest. Each block fails on its own, returns how many
+ * did. cache may be NULL */
+int rift_s_read_firmware_blocks (ohmd_context *ctx, hid_device *handle, rift_s_fw_block_cache **cache,
+		rift_s_fw_block *blocks, int num_blocks);
 
 int rift_s_read_devices_list (hid_device *handle, rift_s_devices_list_t *dev_list);
 
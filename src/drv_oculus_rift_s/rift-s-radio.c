@@ -14,20 +14,6 @@
 #include "rift-s-radio.h"
 #include "rift-s-protocol.h"
 
-/* Struct that forms a double linked queue of pending commands,
- * with the head being the currently active command */
-struct rift_s_radio_command {
-		rift_s_radio_command *prev;
-		rift_s_radio_command *next;
-
-		/* Request packet data */
-    rift_s_hmd_radio_command_t read_command;
-
-		/* Completion callback */
-		rift_s_radio_completion_fn cb;
-		void *cb_data;
-};
-
 static int get_radio_response_report (hid_device *hid, rift_s_hmd_radio_response_t *radio_response)
 {
 	int ret;
@@ -38,15 +24,42 @@ static int get_radio_response_report (hid_device *hid, rift_s_hmd_radio_response
 	return ret;
 }
 
+static void record_latency (rift_s_radio_state *state, double latency)
+{
+	int bucket = 0;
+
+	while (bucket < RIFT_S_RADIO_LATENCY_BUCKETS - 1 && latency * 1000.0 >= (1 << bucket))
+		bucket++;
+
+	state->latency_histogram[bucket]++;
+	if (latency > state->max_latency)
+		state->max_latency = latency;
+}
+
+/* Pops the head command off the queue, the returned pointer is valid until
+ * the next command is queued */
+static rift_s_radio_command *pop_command (rift_s_radio_state *state)
+{
+	rift_s_radio_command *cmd = state->commands + state->queue_head;
+
+	state->queue_head = (state->queue_head + 1) % RIFT_S_RADIO_QUEUE_SIZE;
+	state->queue_len--;
+
+	return cmd;
+}
+
 void
 rift_s_radio_update (rift_s_radio_state *state, hid_device *hid)
 {
 	bool read_another = false;
-	
+
+	/* The radio only takes one command at a time - the response report has
+	 * no way to say which command it answers except the seqnum - so
+	 * commands are sent back to back as each one completes */
 	do {
 		/* Send a radio command if there is none active and some pending */
-		if (state->command_result_pending == false && state->pending_commands) {
-			rift_s_radio_command *cmd = state->pending_commands;
+		if (state->command_result_pending == false && state->queue_len > 0) {
+			rift_s_radio_command *cmd = state->commands + state->queue_head;
  			rift_s_hmd_radio_command_t *pkt = &cmd->read_command;
 
  			pkt->cmd = 0x12;
@@ -82,88 +95,105 @@ rift_s_radio_update (rift_s_radio_state *state, hid_device *hid)
 		state->command_result_pending = false;
 		//rift_s_hexdump_buffer ("ControllerFWReply", (unsigned char *)(&radio_response), ret);
 
- 		assert (state->pending_commands != NULL);
+		assert (state->queue_len > 0);
 
- 		rift_s_radio_command *cmd = state->pending_commands;
+		/* Pop the head off the cmds queue, because it's complete now. The
+		 * callback may queue more commands, so copy out what it needs */
+		rift_s_radio_command cmd = *pop_command (state);
 
- 		/* Pop the head off the cmds queue, because it's complete now */
- 		state->pending_commands = cmd->next;
- 		if (state->pending_commands == NULL)
- 			state->pending_commands_tail = NULL;
- 		else
- 			state->pending_commands->prev = NULL;
+		record_latency (state, ohmd_get_tick() - cmd.queued_time);
 
- 		/* Call the completion callback */
- 		if (cmd->cb)
- 			cmd->cb (true, radio_response.response_bytes, ret - 3, cmd->cb_data);
- 		free(cmd);
- 		read_another = true;
+		/* Call the completion callback */
+		if (cmd.cb)
+			cmd.cb (true, radio_response.response_bytes, ret - 3, cmd.cb_data);
+		read_another = true;
 
 	} while (read_another);
 }
 
 void rift_s_radio_state_init (rift_s_radio_state *state, ohmd_context *ctx)
 {
+	memset (state, 0, sizeof (*state));
+
 	state->ctx = ctx;
 	state->command_result_pending = false;
-	state->pending_commands = NULL;
-	state->pending_commands_tail = NULL;
 	state->last_radio_seqnum = -1;
 }
 
 void rift_s_radio_state_clear (rift_s_radio_state *state)
 {
-	/* Clear and free any pending commands. */
-	rift_s_radio_command *head = state->pending_commands;
-	while (head != NULL) {
-		rift_s_radio_command *prev = head;
-		head = prev->next;
-
-		if (prev->cb)
-				prev->cb (false, NULL, 0, prev->cb_data);
-		free(prev);
+	uint32_t total = 0;
+	char histogram[RIFT_S_RADIO_LATENCY_BUCKETS * 12 + 1] = "";
+	int len = 0;
+
+	for (int i = 0; i < RIFT_S_RADIO_LATENCY_BUCKETS; i++) {
+		total += state->latency_histogram[i];
+		len += snprintf (histogram + len, sizeof(histogram) - len, " %u", state->latency_histogram[i]);
+	}
+
+	if (total > 0) {
+		LOGD ("radio: %u commands, max latency %.1f ms, by power of two ms:%s",
+				total, state->max_latency * 1000.0, histogram);
+	}
+
+	/* Fail any pending commands */
+	while (state->queue_len > 0) {
+		rift_s_radio_command cmd = *pop_command (state);
+
+		if (cmd.cb)
+				cmd.cb (false, NULL, 0, cmd.cb_data);
 	}
 
-	state->pending_commands = state->pending_commands_tail = NULL;
+	state->command_result_pending = false;
 }
 
-void rift_s_radio_queue_command (rift_s_radio_state *state, const uint64_t device_id,
+bool rift_s_radio_queue_command (rift_s_radio_state *state, const uint64_t device_id,
 	const uint8_t *cmd_bytes, const int cmd_bytes_len,
 	rift_s_radio_completion_fn cb, void *cb_data)
 {
-	rift_s_radio_command *cmd = ohmd_alloc(state->ctx, sizeof(rift_s_radio_command));
+	if (state->queue_len == RIFT_S_RADIO_QUEUE_SIZE) {
+		LOGW("Radio command queue full, dropping command 0x%02x", cmd_bytes[0]);
+		return false;
+	}
+
+	rift_s_radio_command *cmd = state->commands +
+			(state->queue_head + state->queue_len) % RIFT_S_RADIO_QUEUE_SIZE;
 
 	assert (cmd_bytes_len <= sizeof (cmd->read_command.cmd_bytes));
 
+	memset (&cmd->read_command, 0, sizeof (cmd->read_command));
 	cmd->read_command.device_id = device_id;
 	memcpy (cmd->read_command.cmd_bytes, cmd_bytes, cmd_bytes_len);
 	cmd->cb = cb;
 	cmd->cb_data = cb_data;
+	cmd->queued_time = ohmd_get_tick();
 
 	/* Append to the pending commands queue. The command itself will be sent by the update() function
 	 * when possible */
-	if (state->pending_commands_tail == NULL) {
-		assert (state->pending_commands == NULL);
-		state->pending_commands = state->pending_commands_tail = cmd;
-	}
-	else {
-		state->pending_commands_tail->next = cmd;
-		cmd->prev = state->pending_commands_tail;
-		state->pending_commands_tail = cmd;
-	}
+	state->queue_len++;
+
+	return true;
 }
 
 /* The current blocks are ~2-3KB, so this should be enough to read
  * the JSON config: */
 #define MAX_JSON_LEN 4096
 
+/* Each read returns at most this many bytes */
+#define JSON_CHUNK_LEN 0x20
+/* Chunk reads queued ahead, leaving room in the queue for other commands */
+#define JSON_READS_AHEAD 32
+
 typedef struct rift_s_radio_json_read_state {
 	rift_s_radio_state *state;
 	uint64_t device_id;
 	rift_s_radio_completion_fn cb;
 	void *cb_data;
 
-	uint32_t cur_offset;
+	uint32_t next_offset; /* Of the next chunk read to queue */
+	int reads_pending;
+	bool finished; /* The callback has been called */
+
 	uint16_t block_len; /* Expected length, from the header */
 
 	uint8_t data[MAX_JSON_LEN+1];
@@ -171,9 +201,102 @@ typedef struct rift_s_radio_json_read_state {
 
 } rift_s_radio_json_read_state;
 
+static void read_json_chunk_cb (bool success, uint8_t *response_bytes, int response_bytes_len,
+		rift_s_radio_json_read_state *json_read);
+
+static void
+json_read_finish (rift_s_radio_json_read_state *json_read, bool success)
+{
+	json_read->finished = true;
+
+	if (json_read->cb)
+		json_read->cb (success, json_read->data, json_read->data_len, json_read->cb_data);
+
+	/* Reads already queued still call back, free the state after the last one */
+	if (json_read->reads_pending == 0)
+		ohmd_free(json_read);
+}
+
+/* Queues chunk reads up to JSON_READS_AHEAD, so they go out back to back */
+static void
+queue_json_reads (rift_s_radio_json_read_state *json_read)
+{
+	/* cmd  = 0x2b  reply_buffer_len = 0x20  timeout(?) = 0x3e8 (=1000) offset = u32   len = u16 */
+	uint8_t read_cmd[] = { 0x2b, 0x20, 0xe8, 0x03, 0x00, 0x00, 0x00, 0x00, JSON_CHUNK_LEN, 0x00 };
+	const uint32_t end_offset = 4 + json_read->block_len;
+
+	while (json_read->reads_pending < JSON_READS_AHEAD && json_read->next_offset < end_offset) {
+		uint8_t read_len = OHMD_MIN (JSON_CHUNK_LEN, end_offset - json_read->next_offset);
+
+		read_cmd[4] = json_read->next_offset;
+		read_cmd[5] = json_read->next_offset >> 8;
+		read_cmd[6] = json_read->next_offset >> 16;
+		read_cmd[7] = json_read->next_offset >> 24;
+		read_cmd[8] = read_len;
+
+		if (!rift_s_radio_queue_command (json_read->state, json_read->device_id, read_cmd, sizeof(read_cmd),
+				(rift_s_radio_completion_fn) read_json_chunk_cb, json_read))
+			break; /* Try again as reads complete */
+
+		json_read->reads_pending++;
+		json_read->next_offset += read_len;
+	}
+}
+
+static void
+read_json_chunk_cb (bool success, uint8_t *response_bytes, int response_bytes_len, rift_s_radio_json_read_state *json_read)
+{
+	json_read->reads_pending--;
+
+	if (json_read->finished) {
+		/* Already reported, only waiting for the queued reads to drain */
+		if (json_read->reads_pending == 0)
+			ohmd_free(json_read);
+		return;
+	}
+
+	if (!success) {
+		json_read_finish (json_read, false);
+		return;
+	}
+
+	if (response_bytes_len < 5) {
+		LOGW("Not enough bytes in radio response - needed 5, got %d\n", response_bytes_len);
+		json_read_finish (json_read, false);
+		return;
+	}
+
+	uint8_t reply_len = response_bytes[4];
+	uint16_t data_remain = json_read->block_len - json_read->data_len;
+
+	if (reply_len > data_remain)
+		reply_len = data_remain; /* Truncate any over-read */
+
+	/* The replies come back in order, append these bytes to the buffer */
+	memcpy (json_read->data + json_read->data_len, response_bytes + 5, reply_len);
+	json_read->data_len += reply_len;
+
+	/* If there is no more to read, then report success to the caller and return */
+	if (json_read->data_len >= json_read->block_len) {
+		json_read->data[json_read->data_len] = 0;
+		json_read_finish (json_read, true);
+		return;
+	}
+
+	/* Otherwise keep the reads coming */
+	queue_json_reads (json_read);
+
+	if (json_read->reads_pending == 0) {
+		LOGW("Remote configuration block ended early, got %u of %u bytes\n", json_read->data_len, json_read->block_len);
+		json_read_finish (json_read, false);
+	}
+}
+
 static void
-read_json_cb (bool success, uint8_t *response_bytes, int response_bytes_len, rift_s_radio_json_read_state *json_read)
+read_json_header_cb (bool success, uint8_t *response_bytes, int response_bytes_len, rift_s_radio_json_read_state *json_read)
 {
+	json_read->reads_pending--;
+
 	if (!success) {
 		/* Failed, report to the caller */
 		goto fail;
@@ -187,91 +310,76 @@ read_json_cb (bool success, uint8_t *response_bytes, int response_bytes_len, rif
 	uint8_t reply_len = response_bytes[4];
 	response_bytes += 5;
 
-	if (json_read->cur_offset == 0) {
-		/* Read the header 0u32 0x20                    01 00 62 09 7b 22 67 79 | .{..... ..b.{"gy
+	/* Read the header 0u32 0x20                    01 00 62 09 7b 22 67 79 | .{..... ..b.{"gy
                             72 6f 5f 6d 22 3a 5b 2d 30 2e 30 31 34 33 35 36 | ro_m":[-0.014356
                             38 38 36 36 2c 2d 30 2e                         | 8866,-0.
         = len 0x20, 0001 (file type, or sequence number?), 0x0962 = file length */
-		if (reply_len < 4) {
-			LOGW("Not enough bytes in remote configuration header - needed 4, got %d\n", reply_len);
-			goto fail; /* Not enough bytes in header */
-		}
-
-		uint16_t file_type = (response_bytes[1] << 8) | response_bytes[0];
-		uint16_t block_len = (response_bytes[3] << 8) | response_bytes[2];
+	if (reply_len < 4) {
+		LOGW("Not enough bytes in remote configuration header - needed 4, got %d\n", reply_len);
+		goto fail; /* Not enough bytes in header */
+	}
 
-		if (file_type != 1) {
-			LOGW("Unknown file type in remote configuration header - expected 1, got %d\n", file_type);
-			goto fail;
-		}
-		/* Assert if the MAX_JSON_LEN ever needs expanding */
-		assert (block_len <= MAX_JSON_LEN);
-		if (block_len > MAX_JSON_LEN) {
-			LOGW("Remote configuration block too long. Please expand the read buffer (needed %u bytes)\n", block_len);
-			goto fail;
-		}
+	uint16_t file_type = (response_bytes[1] << 8) | response_bytes[0];
+	uint16_t block_len = (response_bytes[3] << 8) | response_bytes[2];
 
-		json_read->block_len = block_len;
-		json_read->cur_offset = 0x4;
+	if (file_type != 1) {
+		LOGW("Unknown file type in remote configuration header - expected 1, got %d\n", file_type);
+		goto fail;
+	}
+	/* Assert if the MAX_JSON_LEN ever needs expanding */
+	assert (block_len <= MAX_JSON_LEN);
+	if (block_len > MAX_JSON_LEN) {
+		LOGW("Remote configuration block too long. Please expand the read buffer (needed %u bytes)\n", block_len);
+		goto fail;
 	}
-	else {
-		uint16_t data_remain = json_read->block_len - json_read->data_len;
 
-		if (reply_len > data_remain)
-			reply_len = data_remain; /* Truncate any over-read */
+	json_read->block_len = block_len;
 
-		/* Append these bytes to the buffer */
-		memcpy (json_read->data + json_read->data_len, response_bytes, reply_len);
-		json_read->data_len += reply_len;
-	}
+	/* The rest of this reply is the start of the data */
+	uint16_t data_len = OHMD_MIN (reply_len - 4, block_len);
+	memcpy (json_read->data, response_bytes + 4, data_len);
+	json_read->data_len = data_len;
+	json_read->next_offset = 0x4 + data_len;
 
-	/* If there is no more to read, then report success to the caller and return */
-	if (json_read->data_len >= json_read->block_len) {
+	if (json_read->data_len >= block_len) {
 		json_read->data[json_read->data_len] = 0;
-
-		if (json_read->cb)
-			json_read->cb (true, json_read->data, json_read->data_len, json_read->cb_data);
-		free (json_read);
+		json_read_finish (json_read, true);
 		return;
 	}
 
-	/* Otherwise request more data */
-	uint8_t read_len = OHMD_MIN (0x20, json_read->block_len - json_read->data_len);
-	uint8_t read_cmd[] = { 0x2b, 0x20, 0xe8, 0x03, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00 };
-
-	read_cmd[4] = json_read->cur_offset;
-	read_cmd[5] = json_read->cur_offset >> 8;
-	read_cmd[6] = json_read->cur_offset >> 16;
-	read_cmd[7] = json_read->cur_offset >> 24;
-	read_cmd[8] = read_len;
-
-	rift_s_radio_queue_command (json_read->state, json_read->device_id, read_cmd, sizeof(read_cmd),
-		(rift_s_radio_completion_fn) read_json_cb, json_read);
-
-	json_read->cur_offset += read_len;
+	/* Now the length is known, queue up the whole block */
+	queue_json_reads (json_read);
+	if (json_read->reads_pending == 0)
+		goto fail;
 	return;
 
 fail:
-	if (json_read->cb)
-		json_read->cb (success, json_read->data, json_read->data_len, json_read->cb_data);
-	free (json_read);
-	return;
+	json_read_finish (json_read, false);
 }
 
-void
-rift_s_radio_get_json_block (rift_s_radio_state *state, const uint64_t device_id, 
+bool
+rift_s_radio_get_json_block (rift_s_radio_state *state, const uint64_t device_id,
 		rift_s_radio_completion_fn cb, void *cb_data)
 {
 	/* Configuration JSON block reading */
 	rift_s_radio_json_read_state *json_read = ohmd_alloc (state->ctx, sizeof(rift_s_radio_json_read_state));
 	/* cmd  = 0x2b  reply_buffer_len = 0x20  timeout(?) = 0x3e8 (=1000) offset = 0u32   len = 0x20 */
-	const uint8_t read_cmd[] = { 0x2b, 0x20, 0xe8, 0x03, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00 };
+	const uint8_t read_cmd[] = { 0x2b, 0x20, 0xe8, 0x03, 0x00, 0x00, 0x00, 0x00, JSON_CHUNK_LEN, 0x00 };
+
+	if (!json_read)
+		return false;
 
 	json_read->state = state;
 	json_read->device_id = device_id;
 	json_read->cb = cb;
 	json_read->cb_data = cb_data;
 
-	rift_s_radio_queue_command (state, device_id, read_cmd, sizeof(read_cmd),
-		(rift_s_radio_completion_fn) read_json_cb, json_read);
+	if (!rift_s_radio_queue_command (state, device_id, read_cmd, sizeof(read_cmd),
+			(rift_s_radio_completion_fn) read_json_header_cb, json_read)) {
+		ohmd_free(json_read);
+		return false;
+	}
+	json_read->reads_pending++;
+
+	return true;
 }
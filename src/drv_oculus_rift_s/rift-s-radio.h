@@ -12,29 +12,54 @@
 #define RIFT_S_RADIO_H
 
 #include "rift-s.h"
+#include "rift-s-protocol.h"
 
 typedef struct rift_s_radio_command rift_s_radio_command;
 typedef struct rift_s_radio_state rift_s_radio_state;
 
 typedef void (*rift_s_radio_completion_fn)(bool success, uint8_t *response_bytes, int response_bytes_len, void *cb_data);
 
+/* A JSON block read keeps up to 32 chunk reads queued, with room to spare */
+#define RIFT_S_RADIO_QUEUE_SIZE 160
+/* Bucket i counts commands completed in under 2^i ms, the last one the rest */
+#define RIFT_S_RADIO_LATENCY_BUCKETS 12
+
+struct rift_s_radio_command {
+	/* Request packet data */
+	rift_s_hmd_radio_command_t read_command;
+
+	/* Completion callback */
+	rift_s_radio_completion_fn cb;
+	void *cb_data;
+
+	double queued_time;
+};
+
 struct rift_s_radio_state {
 	ohmd_context* ctx;
 
 	bool command_result_pending;
 	int last_radio_seqnum;
 
-	rift_s_radio_command *pending_commands;
-	rift_s_radio_command *pending_commands_tail;
+	/* Ring of pending commands, the head is the active one */
+	rift_s_radio_command commands[RIFT_S_RADIO_QUEUE_SIZE];
+	int queue_head;
+	int queue_len;
+
+	/* Time from queueing to completion */
+	uint32_t latency_histogram[RIFT_S_RADIO_LATENCY_BUCKETS];
+	double max_latency;
 };
 
 void rift_s_radio_state_init (rift_s_radio_state *state, ohmd_context *ctx);
 void rift_s_radio_state_clear (rift_s_radio_state *state);
 
 void rift_s_radio_update (rift_s_radio_state *state, hid_device *hid);
-void rift_s_radio_queue_command (rift_s_radio_state *state, const uint64_t device_id, const uint8_t *cmd_bytes,
+/* Returns false if the queue is full, cb isn't called then */
+bool rift_s_radio_queue_command (rift_s_radio_state *state, const uint64_t device_id, const uint8_t *cmd_bytes,
 		const int cmd_bytes_len, rift_s_radio_completion_fn cb, void *cb_data);
-void rift_s_radio_get_json_block (rift_s_radio_state *state, const uint64_t device_id, 
+/* Returns false if the read couldn't be queued, cb isn't called then */
+bool rift_s_radio_get_json_block (rift_s_radio_state *state, const uint64_t device_id,
 		rift_s_radio_completion_fn cb, void *cb_data);
 #endif
 
@@ -29,6 +29,10 @@
 #define RIFT_S_INTF_STATUS 7
 #define RIFT_S_INTF_CONTROLLERS 8
 
+/* Each radio poll is a feature report round trip, keep them off the
+ * IMU report path by only polling this often */
+#define RADIO_POLL_INTERVAL (2.0 / 1000.0)
+
 typedef struct device_list_s device_list_t;
 struct device_list_s {
 	char path[OHMD_STR_SIZE];
@@ -37,6 +41,11 @@ struct device_list_s {
 	device_list_t* next;
 };
 
+typedef struct {
+	ohmd_driver base;
+	rift_s_fw_block_cache* fw_cache;
+} rift_s_driver;
+
 typedef struct {
 	const char* name;
 	int company;
@@ -47,10 +56,10 @@ typedef struct {
 /* Global list of (probably 1) active HMD devices */
 static device_list_t* rift_hmds;
 
-static hid_device* open_hid_dev (ohmd_context* ctx, int vid, int pid, int iface_num);
+static hid_device* open_hid_dev (ohmd_context* ctx, int vid, int pid, int iface_num, int *input_fd);
 static void close_hmd (rift_s_hmd_t *hmd);
 
-static rift_s_hmd_t *find_hmd(char *hid_path)
+static rift_s_hmd_t *find_hmd(const char *hid_path)
 {
 	device_list_t* current = rift_hmds;
 
@@ -64,14 +73,18 @@ static rift_s_hmd_t *find_hmd(char *hid_path)
 	return NULL;
 }
 
-static void push_hmd(rift_s_hmd_t *hmd, char *hid_path)
+static bool push_hmd(rift_s_hmd_t *hmd, const char *hid_path)
 {
-	device_list_t* d = calloc(1, sizeof(device_list_t));
+	device_list_t* d = ohmd_alloc(hmd->ctx, sizeof(device_list_t));
+	if (d == NULL)
+		return false;
+
 	d->hmd = hmd;
 	strcpy (d->path, hid_path);
 
 	d->next = rift_hmds;
 	rift_hmds = d;
+	return true;
 }
 
 static void release_hmd(rift_s_hmd_t *hmd)
@@ -95,7 +108,7 @@ static void release_hmd(rift_s_hmd_t *hmd)
 				rift_hmds = current->next;
 			else
 				prev->next = current->next;
-			free (current);
+			ohmd_free (current);
 			return;
 		}
 		prev = current;
@@ -110,14 +123,6 @@ static rift_s_device_priv* rift_s_device_priv_get(ohmd_device* device)
 	return (rift_s_device_priv*)device;
 }
 
-static void
-vec3f_rotate_3x3(vec3f *vec, float rot[3][3])
-{
-	vec3f in = *vec;
-	for (int i = 0; i < 3; i++)
-		vec->arr[i] = rot[i][0] * in.arr[0] + rot[i][1] * in.arr[1] + rot[i][2] * in.arr[2];
-}
-
 static void
 handle_hmd_report (rift_s_hmd_t *priv, const unsigned char *buf, int size)
 {
@@ -136,39 +141,32 @@ handle_hmd_report (rift_s_hmd_t *priv, const unsigned char *buf, int size)
 		end_ts -= dt;
 	}
 
-	const float gyro_scale = 1.0 / priv->imu_config.gyro_scale;
-	const float accel_scale = OHMD_GRAVITY_EARTH / priv->imu_config.accel_scale;
 	const float temperature_scale = 1.0 / priv->imu_config.temperature_scale;
 	const float temperature_offset = priv->imu_config.temperature_offset;
 
-	for(int i = 0; i < 3; i++) {
-		rift_s_hmd_imu_sample_t *s = report.samples + i;
+	vec3f gyro[3], accel[3];
+	int n;
+
+	for (n = 0; n < 3; n++) {
+		rift_s_hmd_imu_sample_t *s = report.samples + n;
 
 		if (s->marker & 0x80)
 				break; /* Sample (and remaining ones) are invalid */
 
-		vec3f gyro, accel;
-		float dt_sec = dt / 1000000.0;
-
-		gyro.x = DEG_TO_RAD(gyro_scale * s->gyro[0]);
-		gyro.y = DEG_TO_RAD(gyro_scale * s->gyro[1]);
-		gyro.z = DEG_TO_RAD(gyro_scale * s->gyro[2]);
-
-		accel.x = accel_scale * s->accel[0];
-		accel.y = accel_scale * s->accel[1];
-		accel.z = accel_scale * s->accel[2];
+		gyro[n] = (vec3f){{ s->gyro[0], s->gyro[1], s->gyro[2] }};
+		accel[n] = (vec3f){{ s->accel[0], s->accel[1], s->accel[2] }};
+	}
 
-		/* Apply correction offsets first, then rectify */
-		for (int j = 0; j < 3; j++) {
-			accel.arr[j] -= priv->imu_calibration.accel.offset_at_0C.arr[j];
-			gyro.arr[j] -= priv->imu_calibration.gyro.offset.arr[j];
-		}
+	/* Scale, offset and rectify the whole report in one go */
+	omat3x4f_transform(&priv->gyro_transform, gyro, gyro, n);
+	omat3x4f_transform(&priv->accel_transform, accel, accel, n);
 
-		vec3f_rotate_3x3(&accel, priv->imu_calibration.accel.rectification);
-		vec3f_rotate_3x3(&gyro, priv->imu_calibration.gyro.rectification);
+	for(int i = 0; i < n; i++) {
+		rift_s_hmd_imu_sample_t *s = report.samples + i;
+		float dt_sec = dt / 1000000.0;
 
-		priv->raw_accel = accel;
-		priv->raw_gyro = gyro;
+		priv->raw_accel = accel[i];
+		priv->raw_gyro = gyro[i];
 		/* FIXME: This doesn't seem to produce the right numbers, but it's OK - we don't use it anyway */
 		priv->temperature = temperature_scale * (s->temperature - temperature_offset) + 25;
 
@@ -205,9 +203,18 @@ static void update_hmd(rift_s_hmd_t *priv)
 				continue;
 
 		while(true){
-			int size = hid_read(priv->handles[i], buf, FEATURE_BUFFER_SIZE);
+			int size;
+			if (priv->input_fds[i] >= 0)
+				size = ohmd_read_input_fd(priv->input_fds[i], buf, FEATURE_BUFFER_SIZE);
+			else
+				size = hid_read(priv->handles[i], buf, FEATURE_BUFFER_SIZE);
 			if(size < 0){
 				LOGE("error reading from HMD device");
+				if (priv->input_fds[i] >= 0) {
+					/* The node is gone, stop waiting on it */
+					ohmd_close_input_fd(priv->input_fds[i]);
+					priv->input_fds[i] = -1;
+				}
 				break;
 			} else if(size == 0) {
 				break; // No more messages, return.
@@ -231,7 +238,12 @@ static void update_hmd(rift_s_hmd_t *priv)
 		}
 	}
 
-	rift_s_radio_update (&priv->radio_state, priv->handles[0]);
+	rift_s_controller_log_drain (priv);
+
+	if (t - priv->last_radio_poll >= RADIO_POLL_INTERVAL) {
+		rift_s_radio_update (&priv->radio_state, priv->handles[0]);
+		priv->last_radio_poll = t;
+	}
 }
 
 static void update_device(ohmd_device* device)
@@ -254,6 +266,24 @@ static void update_device(ohmd_device* device)
 	update_hmd (dev_priv->hmd);
 }
 
+static int get_wait_fds(ohmd_device* device, int* fds, int max)
+{
+	rift_s_device_priv* dev_priv = rift_s_device_priv_get(device);
+	rift_s_hmd_t *hmd = dev_priv->hmd;
+
+	if (max < 3)
+		return 0;
+
+	/* All 3 interfaces need a fd, or the handles must be polled */
+	for (int i = 0; i < 3; i++) {
+		if (hmd->input_fds[i] < 0)
+			return 0;
+		fds[i] = hmd->input_fds[i];
+	}
+
+	return 3;
+}
+
 static int getf_hmd(ohmd_device* device, ohmd_float_value type, float* out)
 {
 	rift_s_device_priv* dev_priv = rift_s_device_priv_get(device);
@@ -338,31 +368,51 @@ static void close_device(ohmd_device* device)
 
 #if 0
 static int
-dump_fw_block(hid_device *handle, uint8_t block_id) {
+dump_fw_block(ohmd_context *ctx, hid_device *handle, uint8_t block_id) {
 	int res;
 	char *data = NULL;
 	int len;
 
-	res = rift_s_read_firmware_block (handle, block_id, &data, &len);
+	res = rift_s_read_firmware_block (ctx, handle, block_id, &data, &len);
 	if (res	< 0)
 			return res;
 
-	free (data);
+	ohmd_free (data);
 	return 0;
 }
 #endif
 
-static int read_calibration (rift_s_hmd_t *hmd, hid_device *hid) {
+static int read_calibration (rift_s_driver *driver, rift_s_hmd_t *hmd, hid_device *hid) {
+	rift_s_fw_block blocks[] = {
+		{ .block_id = RIFT_S_FIRMWARE_BLOCK_IMU_CALIB },
+		{ .block_id = RIFT_S_FIRMWARE_BLOCK_CAMERA_CALIB },
+	};
+	int ret;
 
-	char *json = NULL;
-	int json_len = 0;
+	/* One session for all blocks, so the read timing carries over */
+	rift_s_read_firmware_blocks (hmd->ctx, hid, &driver->fw_cache, blocks, 2);
 
-	int ret = rift_s_read_firmware_block (hid, RIFT_S_FIRMWARE_BLOCK_IMU_CALIB, &json, &json_len);
-	if (ret < 0)
-		return ret;
+	/* The IMU calibration is required */
+	if (blocks[0].data == NULL) {
+		LOGE("No IMU calibration block");
+		ret = -1;
+	}
+	else {
+		ret = rift_s_parse_imu_calibration(hmd->ctx, blocks[0].data, &hmd->imu_calibration);
+	}
 
-	ret = rift_s_parse_imu_calibration(json, &hmd->imu_calibration);
-	free(json);
+	/* The cameras are optional, the HMD still works as a 3DOF device without them */
+	if (blocks[1].data != NULL) {
+		int n = rift_s_parse_camera_calibration(hmd->ctx, blocks[1].data, hmd->cameras, RIFT_S_MAX_CAMERAS);
+		if (n > 0)
+			hmd->num_cameras = n;
+	}
+	else {
+		LOGW("No camera calibration block");
+	}
+
+	for (int i = 0; i < 2; i++)
+		ohmd_free(blocks[i].data);
 
 	return ret;
 }
@@ -424,9 +474,12 @@ static rift_s_hmd_t *open_hmd(ohmd_driver* driver, ohmd_device_desc* desc)
 
 	priv->last_imu_timestamp = -1;
 
+	for (int i = 0; i < 3; i++)
+		priv->input_fds[i] = -1;
+
 	// Open the HID devices
 	for (int i = 0; i < 3; i++) {
-		priv->handles[i] = open_hid_dev (driver->ctx, OCULUS_VR_INC_ID, RIFT_S_PID, interfaces[i]);
+		priv->handles[i] = open_hid_dev (driver->ctx, OCULUS_VR_INC_ID, RIFT_S_PID, interfaces[i], &priv->input_fds[i]);
 		if (priv->handles[i] == NULL)
 			goto cleanup;
 	}
@@ -449,9 +502,15 @@ static rift_s_hmd_t *open_hmd(ohmd_driver* driver, ohmd_device_desc* desc)
 			goto cleanup;
 	}
 
-	if (read_calibration (priv, hid) < 0)
+	if (read_calibration ((rift_s_driver *)driver, priv, hid) < 0)
 			goto cleanup;
 
+	/* Fold the scales, the offsets and the rectification into one transform per sensor */
+	omat3x4f_init_rectify(&priv->gyro_transform, &priv->imu_calibration.gyro.rectification[0][0],
+			DEG_TO_RAD(1.0f / priv->imu_config.gyro_scale), &priv->imu_calibration.gyro.offset);
+	omat3x4f_init_rectify(&priv->accel_transform, &priv->imu_calibration.accel.rectification[0][0],
+			OHMD_GRAVITY_EARTH / priv->imu_config.accel_scale, &priv->imu_calibration.accel.offset_at_0C);
+
 #if 0
 	dump_fw_block(hid, 0xB);
 	dump_fw_block(hid, 0xD);
@@ -496,6 +555,9 @@ static rift_s_hmd_t *open_hmd(ohmd_driver* driver, ohmd_device_desc* desc)
 
 	ohmd_calc_default_proj_matrices(&hmd_dev->base.properties);
 
+	hmd_dev->base.properties.camera_count = priv->num_cameras;
+	hmd_dev->base.properties.cameras = priv->cameras;
+
 	hmd_dev->id = 0;
 	hmd_dev->hmd = priv;
 
@@ -523,6 +585,10 @@ static void close_hmd(rift_s_hmd_t *hmd)
 {
 	rift_s_radio_state_clear (&hmd->radio_state);
 
+	for (int i = 0; i < hmd->num_active_controllers; i++)
+		rift_s_controller_free_imu_calibration (&hmd->controllers[i].calibration);
+	rift_s_controller_log_free (hmd);
+
 	if (hmd->handles[0]) {
 		if (rift_s_hmd_enable (hmd->handles[0], true) < 0) {
 				LOGW("Failed to disable Rift S");
@@ -530,10 +596,12 @@ static void close_hmd(rift_s_hmd_t *hmd)
 	}
 
 	for (int i = 0; i < 3; i++) {
+		if (hmd->input_fds[i] >= 0)
+			ohmd_close_input_fd(hmd->input_fds[i]);
 		if (hmd->handles[i])
 			hid_close(hmd->handles[i]);
 	}
-	free(hmd);
+	ohmd_free(hmd);
 }
 
 /* FIXME: This opens the first device that matches the
@@ -541,7 +609,7 @@ static void close_hmd(rift_s_hmd_t *hmd)
  * 1 rift attached. To support multiple rift, we need to
  * match parent USB devices like ouvrt does */
 static hid_device* open_hid_dev(ohmd_context* ctx,
-		int vid, int pid, int iface_num)
+		int vid, int pid, int iface_num, int *input_fd)
 {
 	struct hid_device_info* devs = hid_enumerate(vid, pid);
 	struct hid_device_info* cur_dev = devs;
@@ -553,8 +621,12 @@ static hid_device* open_hid_dev(ohmd_context* ctx,
 	while (cur_dev) {
 		if (cur_dev->interface_number == iface_num) {
 			handle = hid_open_path(cur_dev->path);
-			if (handle)
+			if (handle) {
+				/* With the hidraw backend, read input through a fd of our
+				 * own that the update thread can wait on */
+				*input_fd = ohmd_open_input_fd(cur_dev->path);
 				break;
+			}
 			else {
 				char* path = _hid_to_unix_path(cur_dev->path);
 				ohmd_set_error(ctx, "Could not open %s.\n"
@@ -576,6 +648,10 @@ static hid_device* open_hid_dev(ohmd_context* ctx,
 
 	return handle;
 cleanup:
+	if (*input_fd >= 0) {
+		ohmd_close_input_fd(*input_fd);
+		*input_fd = -1;
+	}
 	hid_close(handle);
 	return NULL;
 }
@@ -589,7 +665,10 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 		hmd = open_hmd (driver, desc);
 		if (hmd == NULL)
 			return NULL;
-		push_hmd (hmd, desc->path);
+		if (!push_hmd (hmd, desc->path)) {
+			close_hmd (hmd);
+			return NULL;
+		}
 	}
 
 	if (desc->id == 0)
@@ -609,6 +688,7 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 	dev->opened = true;
 
 	dev->base.update = update_device;
+	dev->base.get_wait_fds = get_wait_fds;
 	dev->base.close = close_device;
 	if (desc->id == 0)
 		dev->base.getf = getf_hmd;
@@ -636,31 +716,37 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 		while (cur_dev) {
 			if(rd[i].iface == -1 || cur_dev->interface_number == rd[i].iface) {
 				int id = 0;
-				ohmd_device_desc* desc = &list->devices[list->num_devices++];
+				ohmd_device_desc* desc = ohmd_device_list_add(list);
+				if(!desc)
+					break;
 
-				strcpy(desc->driver, "OpenHMD Rift Driver");
-				strcpy(desc->vendor, "Oculus VR, Inc.");
-				strcpy(desc->product, rd[i].name);
+				desc->driver = ohmd_device_list_intern(list, "OpenHMD Rift Driver");
+				desc->vendor = ohmd_device_list_intern(list, "Oculus VR, Inc.");
+				desc->product = ohmd_device_list_intern(list, rd[i].name);
 
 				desc->revision = 0;
 		
 				desc->device_class = OHMD_DEVICE_CLASS_HMD;
 				desc->device_flags = OHMD_DEVICE_FLAGS_ROTATIONAL_TRACKING;
 
-				strcpy(desc->path, cur_dev->path);
+				desc->path = ohmd_device_list_intern(list, cur_dev->path);
 
 				desc->driver_ptr = driver;
 				desc->id = id++;
 
 				//Controller 0 (left)
-				desc = &list->devices[list->num_devices++];
+				desc = ohmd_device_list_add(list);
+				if(!desc)
+					break;
 				desc->revision = 0;
 
-				strcpy(desc->driver, "OpenHMD Rift Driver");
-				strcpy(desc->vendor, "Oculus VR, Inc.");
-				sprintf(desc->product, "%s: Left Controller", rd[i].name);
+				desc->driver = ohmd_device_list_intern(list, "OpenHMD Rift Driver");
+				desc->vendor = ohmd_device_list_intern(list, "Oculus VR, Inc.");
+				char product[OHMD_STR_SIZE];
+				snprintf(product, OHMD_STR_SIZE, "%s: Left Controller", rd[i].name);
+				desc->product = ohmd_device_list_intern(list, product);
 
-				strcpy(desc->path, cur_dev->path);
+				desc->path = ohmd_device_list_intern(list, cur_dev->path);
 
 				desc->device_flags =
 					//OHMD_DEVICE_FLAGS_POSITIONAL_TRACKING |
@@ -672,14 +758,17 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 				desc->id = id++;
 
 				// Controller 1 (right)
-				desc = &list->devices[list->num_devices++];
+				desc = ohmd_device_list_add(list);
+				if(!desc)
+					break;
 				desc->revision = 0;
 
-				strcpy(desc->driver, "OpenHMD Rift Driver");
-				strcpy(desc->vendor, "Oculus VR, Inc.");
-				sprintf(desc->product, "%s: Right Controller", rd[i].name);
+				desc->driver = ohmd_device_list_intern(list, "OpenHMD Rift Driver");
+				desc->vendor = ohmd_device_list_intern(list, "Oculus VR, Inc.");
+				snprintf(product, OHMD_STR_SIZE, "%s: Right Controller", rd[i].name);
+				desc->product = ohmd_device_list_intern(list, product);
 
-				strcpy(desc->path, cur_dev->path);
+				desc->path = ohmd_device_list_intern(list, cur_dev->path);
 
 				desc->device_flags =
 					//OHMD_DEVICE_FLAGS_POSITIONAL_TRACKING |
@@ -699,21 +788,26 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 
 static void destroy_driver(ohmd_driver* drv)
 {
+	rift_s_driver* rift_s_drv = (rift_s_driver*)drv;
+
 	LOGD("shutting down driver");
 	hid_exit();
-	free(drv);
+	rift_s_fw_block_cache_free(rift_s_drv->fw_cache);
+	ohmd_free(drv);
 
 	ohmd_toggle_ovr_service(1); //re-enable OVRService if previously running
 }
 
 ohmd_driver* ohmd_create_oculus_rift_s_drv(ohmd_context* ctx)
 {
-	ohmd_driver* drv = ohmd_alloc(ctx, sizeof(ohmd_driver));
-	if(drv == NULL)
+	rift_s_driver* rift_s_drv = ohmd_alloc(ctx, sizeof(rift_s_driver));
+	if(rift_s_drv == NULL)
 		return NULL;
 
 	ohmd_toggle_ovr_service(0); //disable OVRService if running
 
+	ohmd_driver* drv = &rift_s_drv->base;
+
 	drv->get_device_list = get_device_list;
 	drv->open_device = open_device;
 	drv->destroy = destroy_driver;
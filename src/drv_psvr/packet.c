@@ -7,6 +7,8 @@
 /* Sony PSVR Driver - Packet reading code. */
 
 
+#include <string.h>
+
 #include "psvr.h"
 
 #ifdef _MSC_VER
@@ -72,3 +74,69 @@ bool psvr_decode_sensor_packet(psvr_sensor_packet* pkt, const unsigned char* buf
 
 	return true;
 }
+
+uint32_t psvr_tick_delta(uint32_t next, uint32_t last)
+{
+	// handles the 24-bit tick counter rolling over, backwards steps come out huge
+	return (next - last) & TICK_MASK;
+}
+
+static bool is_sample_interval(uint32_t delta)
+{
+	return delta >= SAMPLE_TICKS - SAMPLE_JITTER && delta <= SAMPLE_TICKS + SAMPLE_JITTER;
+}
+
+void psvr_sync_init(psvr_sync* sync, double now)
+{
+	memset(sync, 0, sizeof(*sync));
+	sync->state = PSVR_SYNC_STARTUP;
+	sync->reset_fusion = true;
+	sync->drain_end = now + SYNC_DRAIN_TIME;
+}
+
+// The PSVR buffers sensor data, and replays what it had from the previous session when
+// a new one starts. That backlog has regular timing too, so everything read during a
+// fixed window after opening is dropped, however often the device gets polled. After
+// that the stream is trusted once enough packets with regular timing came in, gaps from
+// lost packets don't break the run.
+//
+// Returns false if the packet shouldn't be fused, otherwise delta is the number of ticks
+// between the last fused sample and the first one in the packet.
+bool psvr_sync_packet(psvr_sync* sync, const psvr_sensor_packet* pkt, double now, uint32_t* delta)
+{
+	uint32_t gap = psvr_tick_delta(pkt->samples[0].tick, sync->last_tick);
+	sync->last_tick = pkt->samples[1].tick;
+
+	if (sync->state == PSVR_SYNC_RUNNING) {
+		if (gap != 0 && gap <= MAX_GAP_TICKS) {
+			*delta = gap;
+			return true;
+		}
+
+		// a stall or the counter jumping back, wait for regular data again and only keep the
+		// orientation if time went forward
+		LOGD("sensor stream lost sync, tick_delta = %u", gap);
+		sync->reset_fusion = gap > TICK_MASK / 2;
+		sync->state = PSVR_SYNC_RESYNC;
+		sync->packets = 0;
+	}
+
+	if (now < sync->drain_end)
+		return false;
+
+	if (sync->packets == 0 || gap == 0 || gap > MAX_GAP_TICKS ||
+	    !is_sample_interval(psvr_tick_delta(pkt->samples[1].tick, pkt->samples[0].tick))) {
+		sync->packets = 1;
+		return false;
+	}
+
+	if (++sync->packets < SYNC_PACKETS)
+		return false;
+
+	LOGD("sensor stream synced");
+	sync->state = PSVR_SYNC_RUNNING;
+
+	// the first packet after syncing is fused with the nominal interval
+	*delta = SAMPLE_TICKS;
+	return true;
+}
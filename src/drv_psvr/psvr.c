@@ -13,6 +13,20 @@
 
 #define TICK_LEN (1.0f / 1000000.0f) // 1 MHz ticks
 
+// proximity reads ~150 with nothing in front of the sensor and up to 1023 when worn
+#define PROXIMITY_WORN 600
+#define PROXIMITY_NOT_WORN 400
+
+enum {
+	CONTROL_VOLUME_PLUS,
+	CONTROL_VOLUME_MINUS,
+	CONTROL_MIC_MUTE,
+	CONTROL_PROXIMITY,
+	CONTROL_VOLUME,
+	CONTROL_STATE,
+	CONTROL_COUNT
+};
+
 #define SONY_ID                  0x054c
 #define PSVR_HMD                 0x09af
 
@@ -35,8 +49,12 @@ typedef struct {
 	vec3f raw_accel, raw_gyro;
 	uint8_t last_seq;
 	uint8_t buttons;
+	bool worn;
+	uint16_t volume;
+	uint8_t state;
 	psvr_sensor_packet sensor;
 
+	psvr_sync sync;
 } psvr_priv;
 
 static void accel_from_psvr_vec(const int16_t* smp, vec3f* out_vec)
@@ -54,62 +72,80 @@ static void gyro_from_psvr_vec(const int16_t* smp, vec3f* out_vec)
 }
 
 
-static uint32_t calc_delta_and_handle_rollover(uint32_t next, uint32_t last)
+// Queues events for the controls that changed, each report carries their full state
+static void handle_control_changes(psvr_priv* priv, const psvr_sensor_packet* s)
 {
-	uint32_t tick_delta = next - last;
+	if (priv->buttons != s->buttons) {
+		const uint8_t masks[3] = { PSVR_BUTTON_VOLUME_PLUS, PSVR_BUTTON_VOLUME_MINUS, PSVR_BUTTON_MIC_MUTE };
+
+		for (int i = 0; i < 3; i++) {
+			if ((priv->buttons ^ s->buttons) & masks[i])
+				ohmd_push_control_event(&priv->base, i, (priv->buttons & masks[i]) != 0, (s->buttons & masks[i]) != 0);
+		}
 
-	// The 24-bit tick counter has rolled over,
-	// adjust the "negative" value to be positive.
-	if (tick_delta > 0xffffff) {
-		tick_delta += 0x1000000;
+		priv->buttons = s->buttons;
 	}
 
-	return tick_delta;
+	// the raw proximity is noisy, only report it crossing the thresholds
+	bool worn = priv->worn ? s->proximity >= PROXIMITY_NOT_WORN : s->proximity >= PROXIMITY_WORN;
+	if (worn != priv->worn) {
+		ohmd_push_control_event(&priv->base, CONTROL_PROXIMITY, priv->worn, worn);
+		priv->worn = worn;
+	}
+
+	if (priv->volume != s->volume) {
+		ohmd_push_control_event(&priv->base, CONTROL_VOLUME, priv->volume, s->volume);
+		priv->volume = s->volume;
+	}
+
+	if (priv->state != s->state) {
+		ohmd_push_control_event(&priv->base, CONTROL_STATE, priv->state, s->state);
+		priv->state = s->state;
+	}
 }
 
 static void handle_tracker_sensor_msg(psvr_priv* priv, unsigned char* buffer, int size)
 {
-	uint32_t last_sample_tick = priv->sensor.samples[1].tick;
-
 	if(!psvr_decode_sensor_packet(&priv->sensor, buffer, size)){
 		LOGE("couldn't decode tracker sensor message");
+		return;
 	}
 
 	psvr_sensor_packet* s = &priv->sensor;
+	uint32_t delta;
+	if (!psvr_sync_packet(&priv->sync, s, ohmd_get_tick(), &delta))
+		goto controls;
 
-	uint32_t tick_delta = 500;
-
-	// Startup correction, ignore last_sample_tick if zero.
-	if (last_sample_tick > 0) {
-		tick_delta = calc_delta_and_handle_rollover(
-			s->samples[0].tick, last_sample_tick);
-
-		// The PSVR device can buffer sensor data from previous
-		// sessions which we can get at the start of new sessions.
-		// @todo Maybe just skip the first 10 sensor packets?
-		// @todo Maybe reset sensor fusion?
-		if (tick_delta < 475 || tick_delta > 525) {
-			LOGD("tick_delta = %u", tick_delta);
-			tick_delta = 500;
-		}
+	if (priv->sync.reset_fusion) {
+		ofusion_init(&priv->sensor_fusion);
+		priv->sync.reset_fusion = false;
 	}
 
-	vec3f mag = {{0.0f, 0.0f, 0.0f}};
+	// count the samples that went missing in a real gap, rounding to the sample interval
+	uint32_t lost = 0;
+	if (delta > SAMPLE_TICKS + SAMPLE_JITTER)
+		lost = (delta + SAMPLE_TICKS / 2) / SAMPLE_TICKS - 1;
 
+	fusion_sample samples[2];
 	for (int i = 0; i < 2; i++) {
-		float dt = tick_delta * TICK_LEN;
-		accel_from_psvr_vec(s->samples[i].accel, &priv->raw_accel);
-		gyro_from_psvr_vec(s->samples[i].gyro, &priv->raw_gyro);
+		accel_from_psvr_vec(s->samples[i].accel, &samples[i].accel);
+		gyro_from_psvr_vec(s->samples[i].gyro, &samples[i].ang_vel);
+	}
 
-		ofusion_update(&priv->sensor_fusion, dt, &priv->raw_gyro, &priv->raw_accel, &mag);
+	samples[0].dt = delta * TICK_LEN;
+	samples[1].dt = psvr_tick_delta(s->samples[1].tick, s->samples[0].tick) * TICK_LEN;
+	if (samples[1].dt > MAX_GAP_TICKS * TICK_LEN)
+		samples[1].dt = SAMPLE_TICKS * TICK_LEN;
 
-		if (i == 0) {
-			tick_delta = calc_delta_and_handle_rollover(
-				s->samples[1].tick, s->samples[0].tick);
-		}
-	}
+	vec3f mag = {{0.0f, 0.0f, 0.0f}};
+	ofusion_update_batch(&priv->sensor_fusion, samples, 2, &mag);
+	ohmd_add_sample_stats(&priv->base, 2, lost);
 
-	priv->buttons = s->buttons;
+	priv->raw_accel = samples[1].accel;
+	priv->raw_gyro = samples[1].ang_vel;
+
+controls:
+	handle_control_changes(priv, s);
 }
 
 static void teardown(psvr_priv* priv)
@@ -168,9 +204,12 @@ static int getf(ohmd_device* device, ohmd_float_value type, float* out)
 		break;
 
 	case OHMD_CONTROLS_STATE:
-		out[0] = (priv->buttons & PSVR_BUTTON_VOLUME_PLUS) != 0;
-		out[1] = (priv->buttons & PSVR_BUTTON_VOLUME_MINUS) != 0;
-		out[2] = (priv->buttons & PSVR_BUTTON_MIC_MUTE) != 0;
+		out[CONTROL_VOLUME_PLUS] = (priv->buttons & PSVR_BUTTON_VOLUME_PLUS) != 0;
+		out[CONTROL_VOLUME_MINUS] = (priv->buttons & PSVR_BUTTON_VOLUME_MINUS) != 0;
+		out[CONTROL_MIC_MUTE] = (priv->buttons & PSVR_BUTTON_MIC_MUTE) != 0;
+		out[CONTROL_PROXIMITY] = priv->worn;
+		out[CONTROL_VOLUME] = priv->volume;
+		out[CONTROL_STATE] = priv->state;
 		break;
 
 	default:
@@ -193,7 +232,7 @@ static void close_device(ohmd_device* device)
 
 	teardown(priv);
 
-	free(device);
+	ohmd_free(device);
 }
 
 static hid_device* open_device_idx(int manufacturer, int product, int iface, int device_index)
@@ -287,13 +326,19 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 	priv->base.properties.fov = DEG_TO_RAD(103.57f); //TODO: Confirm exact measurements
 	priv->base.properties.ratio = (1920.0f / 1080.0f) / 2.0f;
 
-	priv->base.properties.control_count = 3;
-	priv->base.properties.controls_hints[0] = OHMD_VOLUME_PLUS;
-	priv->base.properties.controls_hints[1] = OHMD_VOLUME_MINUS;
-	priv->base.properties.controls_hints[2] = OHMD_MIC_MUTE;
-	priv->base.properties.controls_types[0] = OHMD_DIGITAL;
-	priv->base.properties.controls_types[1] = OHMD_DIGITAL;
-	priv->base.properties.controls_types[2] = OHMD_DIGITAL;
+	priv->base.properties.control_count = CONTROL_COUNT;
+	priv->base.properties.controls_hints[CONTROL_VOLUME_PLUS] = OHMD_VOLUME_PLUS;
+	priv->base.properties.controls_hints[CONTROL_VOLUME_MINUS] = OHMD_VOLUME_MINUS;
+	priv->base.properties.controls_hints[CONTROL_MIC_MUTE] = OHMD_MIC_MUTE;
+	priv->base.properties.controls_hints[CONTROL_PROXIMITY] = OHMD_PROXIMITY;
+	priv->base.properties.controls_hints[CONTROL_VOLUME] = OHMD_VOLUME;
+	priv->base.properties.controls_hints[CONTROL_STATE] = OHMD_GENERIC; // raw headset state byte
+	priv->base.properties.controls_types[CONTROL_VOLUME_PLUS] = OHMD_DIGITAL;
+	priv->base.properties.controls_types[CONTROL_VOLUME_MINUS] = OHMD_DIGITAL;
+	priv->base.properties.controls_types[CONTROL_MIC_MUTE] = OHMD_DIGITAL;
+	priv->base.properties.controls_types[CONTROL_PROXIMITY] = OHMD_DIGITAL;
+	priv->base.properties.controls_types[CONTROL_VOLUME] = OHMD_ANALOG;
+	priv->base.properties.controls_types[CONTROL_STATE] = OHMD_ANALOG;
 
 	// calculate projection eye projection matrices from the device properties
 	ohmd_calc_default_proj_matrices(&priv->base.properties);
@@ -305,12 +350,20 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 
 	ofusion_init(&priv->sensor_fusion);
 
+	// throw away what the device queued up before it was opened, the drain window in
+	// psvr_sync_packet() covers the backlog it replays after that
+	unsigned char buffer[FEATURE_BUFFER_SIZE];
+	while (hid_read(priv->hmd_handle, buffer, sizeof(buffer)) > 0)
+		;
+
+	psvr_sync_init(&priv->sync, ohmd_get_tick());
+
 	return (ohmd_device*)priv;
 
 cleanup:
 	if (priv) {
 		teardown(priv);
-		free(priv);
+		ohmd_free(priv);
 	}
 
 	return NULL;
@@ -336,15 +389,19 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 
 		// Register one device for each IMU sensor interface
 		if (cur_dev->interface_number == 4) {
-			desc = &list->devices[list->num_devices++];
+			desc = ohmd_device_list_add(list);
+			if(!desc)
+				break;
 
-			strcpy(desc->driver, "OpenHMD Sony PSVR Driver");
-			strcpy(desc->vendor, "Sony");
-			strcpy(desc->product, "PSVR");
+			desc->driver = ohmd_device_list_intern(list, "OpenHMD Sony PSVR Driver");
+			desc->vendor = ohmd_device_list_intern(list, "Sony");
+			desc->product = ohmd_device_list_intern(list, "PSVR");
 
 			desc->revision = 0;
 
-			snprintf(desc->path, OHMD_STR_SIZE, "%d", idx);
+			char path[16];
+			snprintf(path, sizeof(path), "%d", idx);
+			desc->path = ohmd_device_list_intern(list, path);
 
 			desc->driver_ptr = driver;
 
@@ -363,7 +420,7 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 static void destroy_driver(ohmd_driver* drv)
 {
 	LOGD("shutting down Sony PSVR driver");
-	free(drv);
+	ohmd_free(drv);
 }
 
 ohmd_driver* ohmd_create_psvr_drv(ohmd_context* ctx)
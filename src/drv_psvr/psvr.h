@@ -15,6 +15,17 @@
 
 #include "../openhmdi.h"
 
+#define TICK_MASK 0xffffff // the tick counter is 24 bits
+#define SAMPLE_TICKS 500 // nominal sample interval
+#define SAMPLE_JITTER 25
+
+// gaps up to this long are treated as lost samples, longer ones as a stall
+#define MAX_GAP_TICKS 100000
+// packets with regular timing needed before the data is trusted
+#define SYNC_PACKETS 50
+// seconds after opening during which the device replays its buffered sensor data
+#define SYNC_DRAIN_TIME 1.0
+
 typedef enum
 {
 	PSVR_BUTTON_VOLUME_PLUS = 2,
@@ -40,6 +51,23 @@ typedef struct
 	uint8_t seq;
 } psvr_sensor_packet;
 
+typedef enum
+{
+	// waiting for the sensor stream to settle, nothing goes to fusion
+	PSVR_SYNC_STARTUP,
+	PSVR_SYNC_RESYNC,
+	PSVR_SYNC_RUNNING,
+} psvr_sync_state;
+
+typedef struct
+{
+	psvr_sync_state state;
+	bool reset_fusion; // the orientation is stale once synced again
+	int packets;
+	double drain_end;
+	uint32_t last_tick;
+} psvr_sync;
+
 static const unsigned char psvr_cinematicmode_on[8]  = {
 	0x23, 0x00, 0xaa, 0x04, 0x00, 0x00, 0x00, 0x00
 };
@@ -61,4 +89,8 @@ static const unsigned char psvr_power_on[8]  = {
 void vec3f_from_psvr_vec(const int16_t* smp, vec3f* out_vec);
 bool psvr_decode_sensor_packet(psvr_sensor_packet* pkt, const unsigned char* buffer, int size);
 
+uint32_t psvr_tick_delta(uint32_t next, uint32_t last);
+void psvr_sync_init(psvr_sync* sync, double now);
+bool psvr_sync_packet(psvr_sync* sync, const psvr_sensor_packet* pkt, double now, uint32_t* delta);
+
 #endif
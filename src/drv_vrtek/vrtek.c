@@ -534,8 +534,8 @@ static void close_device(ohmd_device* device)
     LOGD("closing device");
     vrtek_priv* priv = vrtek_priv_get(device);
     hid_close(priv->hid_handle);
-    free(priv->ofusion);
-    free(priv);
+    ohmd_free(priv->ofusion);
+    ohmd_free(priv);
 }
 
 #define UDEV_WIKI_URL "https://github.com/OpenHMD/OpenHMD/wiki/Udev-rules-list"
@@ -615,7 +615,7 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 
 cleanup:
     if (priv)
-        free(priv);
+        ohmd_free(priv);
 
     return NULL;
 }
@@ -633,16 +633,18 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
     while (cur_dev) {
         if (ohmd_wstring_match(cur_dev->manufacturer_string, L"STMicroelectronics") &&
                         ohmd_wstring_match(cur_dev->product_string, L"HID")) {
-            ohmd_device_desc* desc = &list->devices[list->num_devices++];
+            ohmd_device_desc* desc = ohmd_device_list_add(list);
+            if(!desc)
+                break;
 
-            strcpy(desc->driver, "OpenHMD VR-Tek Driver");
-            strcpy(desc->vendor, "VR-Tek");
-            strcpy(desc->product, "VR-Tek WVR");
+            desc->driver = ohmd_device_list_intern(list, "OpenHMD VR-Tek Driver");
+            desc->vendor = ohmd_device_list_intern(list, "VR-Tek");
+            desc->product = ohmd_device_list_intern(list, "VR-Tek WVR");
 
             desc->device_class = OHMD_DEVICE_CLASS_HMD;
             desc->device_flags = OHMD_DEVICE_FLAGS_ROTATIONAL_TRACKING;
 
-            strcpy(desc->path, cur_dev->path);
+            desc->path = ohmd_device_list_intern(list, cur_dev->path);
             desc->driver_ptr = driver;
         }
         cur_dev = cur_dev->next;
@@ -655,7 +657,7 @@ static void destroy_driver(ohmd_driver* drv)
 {
     LOGD("Shutting down VR-Tek driver");
     hid_exit();
-    free(drv);
+    ohmd_free(drv);
 }
 
 ohmd_driver* ohmd_create_vrtek_drv(ohmd_context* ctx)
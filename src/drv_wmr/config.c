@@ -0,0 +1,288 @@
+// Copyright 2026, OpenHMD contributors.
+// SPDX-License-Identifier: BSL-1.0
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ */
+
+/* Windows Mixed Reality Driver - Config Store Parsing */
+
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "wmr.h"
+
+#include "../ext_deps/nxjson.h"
+
+#define MAX_PATH_LEN 256
+
+// Maps dotted key paths like "CalibrationInformation.Displays[0].DisplayWidth" to
+// json nodes. Scalar array items aren't indexed, read them from their array node.
+typedef struct {
+	uint32_t hash;
+	const char* path;
+	const nx_json* node;
+} index_entry;
+
+typedef struct {
+	ohmd_arena* arena;
+	int count;
+	int capacity; // power of two
+	index_entry* entries;
+} json_index;
+
+static const nx_json null_node = { NX_JSON_NULL };
+
+static uint32_t hash_path(const char* path)
+{
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for(; *path; path++)
+		hash = (hash ^ (uint8_t)*path) * 16777619u;
+	return hash;
+}
+
+static void index_insert(index_entry* entries, int capacity, const index_entry* entry)
+{
+	int i = entry->hash & (capacity - 1);
+	while(entries[i].path)
+		i = (i + 1) & (capacity - 1);
+	entries[i] = *entry;
+}
+
+static bool index_add(json_index* index, const char* path, const nx_json* node)
+{
+	// keep the load below one half so probe sequences stay short
+	if((index->count + 1) * 2 > index->capacity){
+		int capacity = index->capacity ? index->capacity * 2 : 256;
+		index_entry* entries = ohmd_arena_alloc(index->arena, sizeof(index_entry) * capacity);
+		if(!entries)
+			return false;
+
+		// the old table stays in the arena until it is released
+		for(int i = 0; i < index->capacity; i++){
+			if(index->entries[i].path)
+				index_insert(entries, capacity, &index->entries[i]);
+		}
+
+		index->entries = entries;
+		index->capacity = capacity;
+	}
+
+	size_t len = strlen(path);
+	char* copy = ohmd_arena_alloc(index->arena, len + 1);
+	if(!copy)
+		return false;
+	memcpy(copy, path, len + 1);
+
+	index_entry entry = { hash_path(path), copy, node };
+	index_insert(index->entries, index->capacity, &entry);
+	index->count++;
+
+	return true;
+}
+
+// Adds the children of node, path holds the path of node itself and has room for MAX_PATH_LEN
+static bool index_children(json_index* index, const nx_json* node, char* path, size_t len)
+{
+	int item = 0;
+
+	for(const nx_json* child = node->child; child; child = child->next, item++){
+		bool container = child->type == NX_JSON_OBJECT || child->type == NX_JSON_ARRAY;
+		int n;
+
+		if(node->type == NX_JSON_ARRAY){
+			if(!container)
+				continue;
+			n = snprintf(path + len, MAX_PATH_LEN - len, "[%d]", item);
+		}else{
+			n = snprintf(path + len, MAX_PATH_LEN - len, len ? ".%s" : "%s", child->key);
+		}
+
+		if(n < 0 || (size_t)n >= MAX_PATH_LEN - len){
+			LOGW("config key path too long, skipping %s", child->key ? child->key : path);
+			continue;
+		}
+
+		if(!index_add(index, path, child))
+			return false;
+
+		if(container && !index_children(index, child, path, len + n))
+			return false;
+	}
+
+	path[len] = '\0';
+	return true;
+}
+
+static bool index_build(json_index* index, ohmd_arena* arena, const nx_json* root)
+{
+	char path[MAX_PATH_LEN] = "";
+
+	memset(index, 0, sizeof(*index));
+	index->arena = arena;
+
+	return index_children(index, root, path, 0);
+}
+
+// Returns a NX_JSON_NULL node if the path isn't there, like nx_json_get()
+static const nx_json* index_get(const json_index* index, const char* fmt, ...)
+{
+	char path[MAX_PATH_LEN];
+	va_list args;
+
+	va_start(args, fmt);
+	int n = vsnprintf(path, sizeof(path), fmt, args);
+	va_end(args);
+
+	if(n < 0 || n >= (int)sizeof(path) || index->capacity == 0)
+		return &null_node;
+
+	uint32_t hash = hash_path(path);
+	for(int i = hash & (index->capacity - 1); index->entries[i].path; i = (i + 1) & (index->capacity - 1)){
+		const index_entry* entry = &index->entries[i];
+		if(entry->hash == hash && strcmp(entry->path, path) == 0)
+			return entry->node;
+	}
+
+	return &null_node;
+}
+
+static bool read_floats(const nx_json* array, float* out, int count)
+{
+	if(array->type != NX_JSON_ARRAY || array->length < count)
+		return false;
+
+	const nx_json* item = array->child;
+	for(int i = 0; i < count; i++, item = item->next)
+		out[i] = (float)item->dbl_value;
+
+	return true;
+}
+
+static void parse_displays(const json_index* index, wmr_config* result)
+{
+	int count = index_get(index, "CalibrationInformation.Displays")->length;
+
+	for(int i = 0; i < count && result->num_displays < 2; i++){
+		wmr_display_calibration* display = &result->displays[result->num_displays];
+
+		display->width = (int)index_get(index, "CalibrationInformation.Displays[%d].DisplayWidth", i)->int_value;
+		display->height = (int)index_get(index, "CalibrationInformation.Displays[%d].DisplayHeight", i)->int_value;
+		if(display->width <= 0 || display->height <= 0)
+			continue;
+
+		if(!read_floats(index_get(index, "CalibrationInformation.Displays[%d].AffineDistortion", i), display->affine, 9))
+			memset(display->affine, 0, sizeof(display->affine));
+
+		result->num_displays++;
+	}
+}
+
+static void parse_imus(const json_index* index, wmr_config* result)
+{
+	static const char* const types[WMR_IMU_COUNT] = {
+		"CALIBRATION_InertialSensorType_Gyro",
+		"CALIBRATION_InertialSensorType_Accelerometer",
+		"CALIBRATION_InertialSensorType_Magnetometer",
+	};
+
+	int count = index_get(index, "CalibrationInformation.InertialSensors")->length;
+
+	for(int i = 0; i < count; i++){
+		const char* type = index_get(index, "CalibrationInformation.InertialSensors[%d].SensorType", i)->text_value;
+		if(!type)
+			continue;
+
+		for(int s = 0; s < WMR_IMU_COUNT; s++){
+			if(strcmp(type, types[s]) != 0)
+				continue;
+
+			wmr_imu_calibration* imu = &result->imus[s];
+			imu->present =
+				read_floats(index_get(index, "CalibrationInformation.InertialSensors[%d].Rt.Rotation", i), imu->rotation, 9) &&
+				read_floats(index_get(index, "CalibrationInformation.InertialSensors[%d].Rt.Translation", i), imu->translation.arr, 3) &&
+				read_floats(index_get(index, "CalibrationInformation.InertialSensors[%d].BiasTemperatureModel", i), imu->bias_model, 12) &&
+				read_floats(index_get(index, "CalibrationInformation.InertialSensors[%d].MixingMatrixTemperatureModel", i), imu->mix_model, 36);
+
+			if(!imu->present)
+				LOGW("incomplete calibration for %s", type);
+			break;
+		}
+	}
+}
+
+static void parse_cameras(const json_index* index, wmr_config* result)
+{
+	int count = index_get(index, "CalibrationInformation.Cameras")->length;
+
+	for(int i = 0; i < count && result->num_cameras < WMR_MAX_CAMERAS; i++){
+		const char* model = index_get(index, "CalibrationInformation.Cameras[%d].Intrinsics.ModelType", i)->text_value;
+		if(!model || strcmp(model, "CALIBRATION_LensDistortionModelRational6KT") != 0){
+			LOGW("unsupported camera lens model %s", model ? model : "(none)");
+			continue;
+		}
+
+		// cx, cy, fx, fy normalized to the sensor size, k1..k6, codx, cody, p2, p1, metric radius
+		float params[15];
+		ohmd_camera_calibration* cam = &result->cameras[result->num_cameras];
+
+		cam->width = (int)index_get(index, "CalibrationInformation.Cameras[%d].SensorWidth", i)->int_value;
+		cam->height = (int)index_get(index, "CalibrationInformation.Cameras[%d].SensorHeight", i)->int_value;
+
+		if(!read_floats(index_get(index, "CalibrationInformation.Cameras[%d].Intrinsics.ModelParameters", i), params, 15) ||
+		   !read_floats(index_get(index, "CalibrationInformation.Cameras[%d].Rt.Rotation", i), cam->rotation, 9) ||
+		   !read_floats(index_get(index, "CalibrationInformation.Cameras[%d].Rt.Translation", i), cam->translation.arr, 3)){
+			LOGW("incomplete calibration for camera %d", i);
+			continue;
+		}
+
+		cam->model = OHMD_CAMERA_DISTORTION_RATIONAL;
+		cam->cx = params[0] * cam->width;
+		cam->cy = params[1] * cam->height;
+		cam->fx = params[2] * cam->width;
+		cam->fy = params[3] * cam->height;
+		memcpy(cam->k, params + 4, sizeof(cam->k));
+		cam->p[0] = params[13];
+		cam->p[1] = params[12];
+
+		result->num_cameras++;
+	}
+}
+
+bool wmr_config_parse(ohmd_context* ctx, wmr_config* result, char* json)
+{
+	// the json nodes and the index are only needed while picking out the values
+	ohmd_arena arena;
+	nx_json_allocator allocator;
+	json_index index;
+	bool ret = false;
+
+	memset(result, 0, sizeof(*result));
+
+	ohmd_arena_init(&arena, ctx, 0);
+	ohmd_arena_json_allocator(&arena, &allocator);
+
+	const nx_json* root = nx_json_parse_alloc(json, NULL, &allocator);
+	if(!root || root->type != NX_JSON_OBJECT){
+		LOGE("could not parse the config json");
+		goto out;
+	}
+
+	if(!index_build(&index, &arena, root)){
+		LOGE("out of memory indexing the config json");
+		goto out;
+	}
+
+	parse_displays(&index, result);
+	parse_imus(&index, result);
+	parse_cameras(&index, result);
+
+	LOGD("config: %d displays, %d cameras, %d json nodes indexed", result->num_displays, result->num_cameras, index.count);
+	ret = true;
+
+out:
+	ohmd_arena_release(&arena);
+	return ret;
+}
@@ -7,6 +7,8 @@
 /* Windows Mixed Reality Driver */
 
 
+#include <limits.h>
+
 #include "wmr.h"
 
 #ifdef _MSC_VER
@@ -76,3 +78,140 @@ bool hololens_sensors_decode_packet(hololens_sensors_packet* pkt, const unsigned
 
 	return true;
 }
+
+// Raw temperature units, assumed to be hundredths of a degree Celsius. No capture confirms
+// this yet, enabling the temperature model warns about it
+#define TEMPERATURE_SCALE 0.01f
+// Readings outside this range mean the unit above is wrong, degrees Celsius
+#define TEMPERATURE_MIN -10.0f
+#define TEMPERATURE_MAX 80.0f
+
+void hololens_imu_transform_init(hololens_imu_transform* t, const wmr_imu_calibration* calibration, float scale)
+{
+	t->calibration = calibration && calibration->present ? calibration : NULL;
+	t->scale = scale;
+	t->temperature_model = false;
+	t->warned = false;
+	t->temperature = INT_MIN;
+}
+
+void hololens_imu_transform_set_temperature_model(hololens_imu_transform* t, bool enable)
+{
+	if(t->temperature_model == enable)
+		return;
+
+	t->temperature_model = enable;
+	t->temperature = INT_MIN;
+}
+
+static float eval_temperature_model(const float c[4], float temp)
+{
+	return c[0] + temp * (c[1] + temp * (c[2] + temp * c[3]));
+}
+
+// Folds the nominal scale, bias and mixing matrix at the given temperature into
+// one affine transform, this only runs when the temperature reading changes.
+// Without the temperature model only the constant terms are used.
+static void update_transform(hololens_imu_transform* t, int temperature)
+{
+	float mix[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+	vec3f bias = {{ 0, 0, 0 }};
+
+	if(!t->temperature_model){
+		temperature = 0;
+	}else if(temperature * TEMPERATURE_SCALE < TEMPERATURE_MIN || temperature * TEMPERATURE_SCALE > TEMPERATURE_MAX){
+		if(!t->warned)
+			LOGW("implausible IMU temperature %.2f C, using the constant calibration terms", temperature * TEMPERATURE_SCALE);
+		t->warned = true;
+		temperature = 0;
+	}
+
+	if(t->temperature == temperature)
+		return;
+
+	t->temperature = temperature;
+
+	if(t->calibration){
+		float temp = temperature * TEMPERATURE_SCALE;
+		for(int i = 0; i < 9; i++)
+			mix[i] = eval_temperature_model(t->calibration->mix_model + i * 4, temp);
+		for(int i = 0; i < 3; i++)
+			bias.arr[i] = eval_temperature_model(t->calibration->bias_model + i * 4, temp);
+	}
+
+	// out = mix * (scale * raw - bias)
+	omat3x4f_init_rectify(&t->transform, mix, t->scale, &bias);
+}
+
+// Gyro sub-samples are 8 per accelerometer sample, averaged or taken one by one
+static void average_gyro_groups(const int16_t smp[3][32], vec3f out[4])
+{
+	for(int i = 0; i < 4; i++){
+		for(int axis = 0; axis < 3; axis++){
+			int32_t sum = 0;
+			for(int j = 0; j < 8; j++)
+				sum += smp[axis][8 * i + j];
+			out[i].arr[axis] = (float)sum * 0.125f;
+		}
+	}
+}
+
+static void convert_gyro(const int16_t smp[3][32], vec3f out[32])
+{
+	for(int i = 0; i < 32; i++){
+		for(int axis = 0; axis < 3; axis++)
+			out[i].arr[axis] = (float)smp[axis][i];
+	}
+}
+
+int hololens_sensors_get_fusion_samples(const hololens_sensors_packet* pkt, uint64_t last_sample_tick, bool high_rate,
+                                        hololens_imu_transform* gyro_transform, hololens_imu_transform* accel_transform,
+                                        fusion_sample* out)
+{
+	const int per_group = high_rate ? 8 : 1;
+	vec3f gyro[32], accel[4];
+
+	if(high_rate)
+		convert_gyro(pkt->gyro, gyro);
+	else
+		average_gyro_groups(pkt->gyro, gyro);
+
+	for(int i = 0; i < 4; i++){
+		for(int axis = 0; axis < 3; axis++)
+			accel[i].arr[axis] = (float)pkt->accel[axis][i];
+	}
+
+	// the temperature comes with each group, the transforms are only rebuilt when it changes
+	for(int i = 0; i < 4; i++){
+		update_transform(gyro_transform, (int16_t)pkt->temperature[i]);
+		omat3x4f_transform(&gyro_transform->transform, gyro + i * per_group, gyro + i * per_group, per_group);
+
+		update_transform(accel_transform, (int16_t)pkt->temperature[i]);
+		omat3x4f_transform(&accel_transform->transform, accel + i, accel + i, 1);
+	}
+
+	for(int i = 0; i < 4; i++){
+		uint64_t tick_delta = 1000;
+		if(last_sample_tick > 0) //startup correction
+			tick_delta = pkt->gyro_timestamp[i] - last_sample_tick;
+
+		// the timestamp covers the whole group of gyro sub-samples
+		float dt = tick_delta * TICK_LEN / per_group;
+
+		vec3f group_accel = {{ -accel[i].y, -accel[i].x, -accel[i].z }};
+
+		for(int j = 0; j < per_group; j++){
+			int k = i * per_group + j;
+
+			out[k].dt = dt;
+			out[k].accel = group_accel;
+			out[k].ang_vel.x = -gyro[k].y;
+			out[k].ang_vel.y = -gyro[k].x;
+			out[k].ang_vel.z = -gyro[k].z;
+		}
+
+		last_sample_tick = pkt->gyro_timestamp[i];
+	}
+
+	return 4 * per_group;
+}
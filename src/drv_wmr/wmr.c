@@ -9,8 +9,6 @@
 
 #define FEATURE_BUFFER_SIZE 497
 
-#define TICK_LEN (1.0f / 10000000.0f) // 1000 Hz ticks
-
 #define MICROSOFT_VID        0x045e
 #define HOLOLENS_SENSORS_PID 0x0659
 
@@ -25,8 +23,6 @@
 #include "wmr.h"
 #include "config_key.h"
 
-#include "../ext_deps/nxjson.h"
-
 typedef struct {
 	ohmd_device base;
 
@@ -36,44 +32,11 @@ typedef struct {
 	uint32_t last_ticks;
 	uint8_t last_seq;
 	hololens_sensors_packet sensor;
+	wmr_config config;
+	hololens_imu_transform gyro_transform, accel_transform;
 
 } wmr_priv;
 
-static void vec3f_from_hololens_gyro(int16_t smp[3][32], int i, vec3f* out_vec)
-{
-	out_vec->x = (float)(smp[1][8*i+0] +
-			     smp[1][8*i+1] +
-			     smp[1][8*i+2] +
-			     smp[1][8*i+3] +
-			     smp[1][8*i+4] +
-			     smp[1][8*i+5] +
-			     smp[1][8*i+6] +
-			     smp[1][8*i+7]) * 0.001f * -0.125f;
-	out_vec->y = (float)(smp[0][8*i+0] +
-			     smp[0][8*i+1] +
-			     smp[0][8*i+2] +
-			     smp[0][8*i+3] +
-			     smp[0][8*i+4] +
-			     smp[0][8*i+5] +
-			     smp[0][8*i+6] +
-			     smp[0][8*i+7]) * 0.001f * -0.125f;
-	out_vec->z = (float)(smp[2][8*i+0] +
-			     smp[2][8*i+1] +
-			     smp[2][8*i+2] +
-			     smp[2][8*i+3] +
-			     smp[2][8*i+4] +
-			     smp[2][8*i+5] +
-			     smp[2][8*i+6] +
-			     smp[2][8*i+7]) * 0.001f * -0.125f;
-}
-
-static void vec3f_from_hololens_accel(int32_t smp[3][4], int i, vec3f* out_vec)
-{
-	out_vec->x = (float)smp[1][i] * 0.001f * -1.0f;
-	out_vec->y = (float)smp[0][i] * 0.001f * -1.0f;
-	out_vec->z = (float)smp[2][i] * 0.001f * -1.0f;
-}
-
 static void handle_tracker_sensor_msg(wmr_priv* priv, unsigned char* buffer, int size)
 {
 	uint64_t last_sample_tick = priv->sensor.gyro_timestamp[3];
@@ -82,25 +45,23 @@ static void handle_tracker_sensor_msg(wmr_priv* priv, unsigned char* buffer, int
 		LOGE("couldn't decode tracker sensor message");
 	}
 
-	hololens_sensors_packet* s = &priv->sensor;
-
-
-	vec3f mag = {{0.0f, 0.0f, 0.0f}};
+	// the settings are only known once the device is open
+	if(priv->base.settings.temperature_calibration && !priv->gyro_transform.temperature_model)
+		LOGW("temperature calibration enabled, the IMU temperature unit is unconfirmed (assumed 0.01 C)");
 
-	for(int i = 0; i < 4; i++){
-		uint64_t tick_delta = 1000;
-		if(last_sample_tick > 0) //startup correction
-			tick_delta = s->gyro_timestamp[i] - last_sample_tick;
+	hololens_imu_transform_set_temperature_model(&priv->gyro_transform, priv->base.settings.temperature_calibration);
+	hololens_imu_transform_set_temperature_model(&priv->accel_transform, priv->base.settings.temperature_calibration);
 
-		float dt = tick_delta * TICK_LEN;
+	fusion_sample samples[HOLOLENS_HIGH_RATE_SAMPLES];
+	int count = hololens_sensors_get_fusion_samples(&priv->sensor, last_sample_tick,
+	                                                priv->base.settings.high_rate_sensors,
+	                                                &priv->gyro_transform, &priv->accel_transform, samples);
 
-		vec3f_from_hololens_gyro(s->gyro, i, &priv->raw_gyro);
-		vec3f_from_hololens_accel(s->accel, i, &priv->raw_accel);
-
-		ofusion_update(&priv->sensor_fusion, dt, &priv->raw_gyro, &priv->raw_accel, &mag);
+	vec3f mag = {{0.0f, 0.0f, 0.0f}};
+	ofusion_update_batch(&priv->sensor_fusion, samples, count, &mag);
 
-		last_sample_tick = s->gyro_timestamp[i];
-	}
+	priv->raw_gyro = samples[count - 1].ang_vel;
+	priv->raw_accel = samples[count - 1].accel;
 }
 
 static void update_device(ohmd_device* device)
@@ -145,6 +106,26 @@ static int getf(ohmd_device* device, ohmd_float_value type, float* out)
 		memset(out, 0, sizeof(float) * 6);
 		break;
 
+	case OHMD_IMU_CALIBRATION:
+		for(int i = 0; i < WMR_IMU_COUNT; i++){
+			const wmr_imu_calibration* imu = &priv->config.imus[i];
+			float* o = out + i * 60;
+
+			if(imu->present){
+				memcpy(o, imu->rotation, sizeof(float) * 9);
+				memcpy(o + 9, imu->translation.arr, sizeof(float) * 3);
+				memcpy(o + 12, imu->bias_model, sizeof(float) * 12);
+				memcpy(o + 24, imu->mix_model, sizeof(float) * 36);
+			}else{
+				memset(o, 0, sizeof(float) * 60);
+				for(int j = 0; j < 3; j++){
+					o[j * 4] = 1.0f;
+					o[24 + j * 16] = 1.0f;
+				}
+			}
+		}
+		break;
+
 	default:
 		ohmd_set_error(priv->base.ctx, "invalid type given to getf (%ud)", type);
 		return -1;
@@ -162,7 +143,7 @@ static void close_device(ohmd_device* device)
 
 	hid_close(priv->hmd_imu);
 
-	free(device);
+	ohmd_free(device);
 }
 
 static hid_device* open_device_idx(int manufacturer, int product, int iface, int iface_tot, int device_index)
@@ -279,13 +260,13 @@ unsigned char *read_config(wmr_priv *priv)
 	 * seem to be little endian size of the data store.
 	 */
 	data_size = meta[0] | (meta[1] << 8);
-	data = calloc(1, data_size);
+	data = ohmd_alloc(priv->base.ctx, data_size);
 	if (!data)
                 return NULL;
 
 	size = read_config_part(priv, 0x04, data, data_size);
 	if (size == -1) {
-		free(data);
+		ohmd_free(data);
 		return NULL;
 	}
 
@@ -297,33 +278,6 @@ unsigned char *read_config(wmr_priv *priv)
 }
 
 
-void process_nxjson_obj(const nx_json* node, const nx_json* (*list)[32], char* match)
-{
-	if (!node)
-		return;
-
-	if (node->key)
-		if (strcmp(match,node->key) == 0) 
-		{
-			//LOGE("Found key %s\n", node->key);
-			for (int i = 0; i < 32; i++)
-			{
-				if (!list[0][i]) {
-					list[0][i] = node;
-					break;
-				}
-			}
-		}
-
-	process_nxjson_obj(node->next, list, match);
-	process_nxjson_obj(node->child, list, match);
-}
-
-void resetList(const nx_json* (*list)[32])
-{
-	memset(list, 0, sizeof(*list));
-}
-
 static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 {
 	wmr_priv* priv = ohmd_alloc(driver->ctx, sizeof(wmr_priv));
@@ -343,9 +297,6 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 	if(!priv->hmd_imu)
 		goto cleanup;
 
-	//Bunch of temp variables to set to the display configs
-	int resolution_h, resolution_v; 
-
 	config = read_config(priv);
 	if (config) {
 		wmr_config_header* hdr = (wmr_config_header*)config;
@@ -356,47 +307,10 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 		}
 
 		char *json_data = (char*)config + hdr->json_start + sizeof(uint16_t);
-		const nx_json* json = nx_json_parse(json_data, 0);
-
-		if (json->type != NX_JSON_NULL) 
-		{
-			//list to save found nodes with matching name
-			const nx_json* returnlist[32] = {0};
-			resetList(&returnlist); process_nxjson_obj(json, &returnlist, "DisplayHeight");
-			LOGE("Found display height %lli\n", returnlist[0]->int_value); //taking the first element since it does not matter if you take display 0 or 1
-			resolution_v = returnlist[0]->int_value;
-			resetList(&returnlist); process_nxjson_obj(json, &returnlist, "DisplayWidth");
-			LOGE("Found display width %lli\n", returnlist[0]->int_value); //taking the first element since it does not matter if you take display 0 or 1
-			resolution_h = returnlist[0]->int_value;
-			
-			//Left in for debugging until we confirmed most variables working
-			/*
-		 	for (int i = 0; i < 32; i++)
-		 	{
-		 		if (returnlist[i] != 0)
-		 		{
-		 			if (returnlist[i]->type == NX_JSON_STRING)
-		 				printf("Found %s\n", returnlist[i]->text_value);
-		 			if (returnlist[i]->type == NX_JSON_INTEGER)
-		 				printf("Found %lli\n", returnlist[i]->int_value);
-		 			if (returnlist[i]->type == NX_JSON_DOUBLE)
-		 				printf("Found %f\n", returnlist[i]->dbl_value);
-		 			if (returnlist[i]->type == NX_JSON_ARRAY)
-		 				printf("Found array, TODO\n");
-		 		}
-		 	}*/
-
-		}
-		else 
-		{
-			LOGE("Could not parse json\n");
-		}
-
-		//TODO: use new config data
+		if (!wmr_config_parse(driver->ctx, &priv->config, json_data))
+			LOGE("Could not parse the config from the firmware\n");
 
-		nx_json_free(json);
-
-		free(config);
+		ohmd_free(config);
 	}
 	else {
 		LOGE("Could not read config from the firmware\n");
@@ -418,8 +332,8 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 		// Samsung Odyssey has two 3.5" 1440x1600 OLED displays.
 		priv->base.properties.hsize = 0.118942f;
 		priv->base.properties.vsize = 0.066079f;
-		priv->base.properties.hres = resolution_h;
-		priv->base.properties.vres = resolution_v;
+		priv->base.properties.hres = 2880;
+		priv->base.properties.vres = 1600;
 		priv->base.properties.lens_sep = 0.063f; /* FIXME */
 		priv->base.properties.lens_vpos = 0.03304f; /* FIXME */
 		priv->base.properties.fov = DEG_TO_RAD(110.0f);
@@ -428,14 +342,32 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 		// Most Windows Mixed Reality Headsets have two 2.89" 1440x1440 LCDs
 		priv->base.properties.hsize = 0.103812f;
 		priv->base.properties.vsize = 0.051905f;
-		priv->base.properties.hres = resolution_h;
-		priv->base.properties.vres = resolution_v;
+		priv->base.properties.hres = 2880;
+		priv->base.properties.vres = 1440;
 		priv->base.properties.lens_sep = 0.063f; /* FIXME */
 		priv->base.properties.lens_vpos = 0.025953f; /* FIXME */
 		priv->base.properties.fov = DEG_TO_RAD(95.0f);
 		priv->base.properties.ratio = 1.0f;
 	}
 
+	// the displays in the config are per eye, side by side
+	if (priv->config.num_displays == 2) {
+		const wmr_display_calibration* left = &priv->config.displays[0];
+		const wmr_display_calibration* right = &priv->config.displays[1];
+		priv->base.properties.hres = left->width + right->width;
+		priv->base.properties.vres = left->height;
+
+		// the affine transforms carry the lens centers in display pixels
+		if (left->affine[8] != 0.0f && right->affine[8] != 0.0f) {
+			float pixel_size = priv->base.properties.hsize / priv->base.properties.hres;
+			priv->base.properties.lens_sep = (left->width - left->affine[2] + right->affine[2]) * pixel_size;
+			priv->base.properties.lens_vpos = (left->height - left->affine[5]) * pixel_size;
+		}
+	}
+
+	priv->base.properties.camera_count = priv->config.num_cameras;
+	priv->base.properties.cameras = priv->config.cameras;
+
 	// calculate projection eye projection matrices from the device properties
 	ohmd_calc_default_proj_matrices(&priv->base.properties);
 
@@ -444,13 +376,17 @@ static ohmd_device* open_device(ohmd_driver* driver, ohmd_device_desc* desc)
 	priv->base.close = close_device;
 	priv->base.getf = getf;
 
+	// raw samples are in mrad/s and mm/s^2, the factory calibration is applied on top
+	hololens_imu_transform_init(&priv->gyro_transform, &priv->config.imus[WMR_IMU_GYRO], 0.001f);
+	hololens_imu_transform_init(&priv->accel_transform, &priv->config.imus[WMR_IMU_ACCEL], 0.001f);
+
 	ofusion_init(&priv->sensor_fusion);
 
 	return (ohmd_device*)priv;
 
 cleanup:
 	if(priv)
-		free(priv);
+		ohmd_free(priv);
 
 	return NULL;
 }
@@ -462,15 +398,19 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 
 	int idx = 0;
 	while (cur_dev) {
-		ohmd_device_desc* desc = &list->devices[list->num_devices++];
+		ohmd_device_desc* desc = ohmd_device_list_add(list);
+		if(!desc)
+			break;
 
-		strcpy(desc->driver, "OpenHMD Windows Mixed Reality Driver");
-		strcpy(desc->vendor, "Microsoft");
-		strcpy(desc->product, "HoloLens Sensors");
+		desc->driver = ohmd_device_list_intern(list, "OpenHMD Windows Mixed Reality Driver");
+		desc->vendor = ohmd_device_list_intern(list, "Microsoft");
+		desc->product = ohmd_device_list_intern(list, "HoloLens Sensors");
 
 		desc->revision = 0;
 
-		snprintf(desc->path, OHMD_STR_SIZE, "%d", idx);
+		char path[16];
+		snprintf(path, sizeof(path), "%d", idx);
+		desc->path = ohmd_device_list_intern(list, path);
 
 		desc->driver_ptr = driver;
 
@@ -487,7 +427,7 @@ static void get_device_list(ohmd_driver* driver, ohmd_device_list* list)
 static void destroy_driver(ohmd_driver* drv)
 {
 	LOGD("shutting down Windows Mixed Reality driver");
-	free(drv);
+	ohmd_free(drv);
 }
 
 ohmd_driver* ohmd_create_wmr_drv(ohmd_context* ctx)
@@ -50,6 +50,65 @@ typedef struct {
         char revision_date[0x20];
 } wmr_config_header;
 
+#define WMR_MAX_CAMERAS 4
+
+typedef enum
+{
+	WMR_IMU_GYRO = 0,
+	WMR_IMU_ACCEL = 1,
+	WMR_IMU_MAG = 2,
+	WMR_IMU_COUNT
+} wmr_imu_sensor;
+
+// factory calibration of one inertial sensor, the models are cubic in temperature
+typedef struct
+{
+	bool present;
+	float rotation[9]; // row-major, sensor to HMD
+	vec3f translation; // metres
+	float bias_model[12]; // c0..c3 for each axis
+	float mix_model[36]; // c0..c3 for each element of a row-major 3x3 matrix
+} wmr_imu_calibration;
+
+typedef struct
+{
+	int width, height; // pixels
+	float affine[9]; // row-major, maps normalized lens coordinates to pixels
+} wmr_display_calibration;
+
+// calibration from the JSON config store
+typedef struct
+{
+	int num_displays;
+	wmr_display_calibration displays[2]; // left, right
+	wmr_imu_calibration imus[WMR_IMU_COUNT];
+	int num_cameras;
+	ohmd_camera_calibration cameras[WMR_MAX_CAMERAS];
+} wmr_config;
+
+// calibration applied to raw IMU samples, rebuilt when the temperature changes
+typedef struct
+{
+	const wmr_imu_calibration* calibration; // NULL for the nominal scale only
+	float scale; // raw units to rad/s or m/s^2
+	bool temperature_model; // apply the temperature terms of the calibration, off by default
+	bool warned; // an implausible temperature was reported
+	int temperature; // raw temperature the transform was computed for
+	mat3x4f transform;
+} hololens_imu_transform;
+
+#define TICK_LEN (1.0f / 10000000.0f) // 1000 Hz ticks
+
+// fusion samples per packet, averaged or one for every gyro sub-sample
+#define HOLOLENS_SAMPLES 4
+#define HOLOLENS_HIGH_RATE_SAMPLES 32
+
 bool hololens_sensors_decode_packet(hololens_sensors_packet* pkt, const unsigned char* buffer, int size);
+void hololens_imu_transform_init(hololens_imu_transform* t, const wmr_imu_calibration* calibration, float scale);
+void hololens_imu_transform_set_temperature_model(hololens_imu_transform* t, bool enable);
+int hololens_sensors_get_fusion_samples(const hololens_sensors_packet* pkt, uint64_t last_sample_tick, bool high_rate,
+                                        hololens_imu_transform* gyro_transform, hololens_imu_transform* accel_transform,
+                                        fusion_sample* out);
+bool wmr_config_parse(ohmd_context* ctx, wmr_config* result, char* json);
 
 #endif
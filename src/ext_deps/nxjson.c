@@ -39,8 +39,8 @@ extern "C" {
 
 static const nx_json dummy={ NX_JSON_NULL };
 
-static nx_json* create_json(nx_json_type type, const char* key, nx_json* parent) {
-  nx_json* js=NX_JSON_CALLOC();
+static nx_json* create_json(nx_json_type type, const char* key, nx_json* parent, const nx_json_allocator* allocator) {
+  nx_json* js=allocator ? (nx_json*)allocator->alloc(allocator->user_data, sizeof(nx_json)) : NX_JSON_CALLOC();
   assert(js);
   js->type=type;
   js->key=key;
@@ -56,15 +56,20 @@ static nx_json* create_json(nx_json_type type, const char* key, nx_json* parent)
   return js;
 }
 
-void nx_json_free(const nx_json* js) {
+void nx_json_free_alloc(const nx_json* js, const nx_json_allocator* allocator) {
   nx_json* p=js->child;
   nx_json* p1;
   while (p) {
     p1=p->next;
-    nx_json_free(p);
+    nx_json_free_alloc(p, allocator);
     p=p1;
   }
-  NX_JSON_FREE(js);
+  if (allocator) allocator->free(allocator->user_data, (void*)js);
+  else NX_JSON_FREE(js);
+}
+
+void nx_json_free(const nx_json* js) {
+  nx_json_free_alloc(js, 0);
 }
 
 static int unicode_to_utf8(unsigned int codepoint, char* p, char** endp) {
@@ -229,7 +234,7 @@ static char* parse_key(const char** key, char* p, nx_json_unicode_encoder encode
   return 0; // error
 }
 
-static char* parse_value(nx_json* parent, const char* key, char* p, nx_json_unicode_encoder encoder) {
+static char* parse_value(nx_json* parent, const char* key, char* p, nx_json_unicode_encoder encoder, const nx_json_allocator* allocator) {
   nx_json* js;
   while (1) {
     switch (*p) {
@@ -242,21 +247,21 @@ static char* parse_value(nx_json* parent, const char* key, char* p, nx_json_unic
         p++;
         break;
       case '{':
-        js=create_json(NX_JSON_OBJECT, key, parent);
+        js=create_json(NX_JSON_OBJECT, key, parent, allocator);
         p++;
         while (1) {
           const char* new_key;
           p=parse_key(&new_key, p, encoder);
           if (!p) return 0; // error
           if (*p=='}') return p+1; // end of object
-          p=parse_value(js, new_key, p, encoder);
+          p=parse_value(js, new_key, p, encoder, allocator);
           if (!p) return 0; // error
         }
       case '[':
-        js=create_json(NX_JSON_ARRAY, key, parent);
+        js=create_json(NX_JSON_ARRAY, key, parent, allocator);
         p++;
         while (1) {
-          p=parse_value(js, 0, p, encoder);
+          p=parse_value(js, 0, p, encoder, allocator);
           if (!p) return 0; // error
           if (*p==']') return p+1; // end of array
         }
@@ -264,13 +269,13 @@ static char* parse_value(nx_json* parent, const char* key, char* p, nx_json_unic
         return p;
       case '"':
         p++;
-        js=create_json(NX_JSON_STRING, key, parent);
+        js=create_json(NX_JSON_STRING, key, parent, allocator);
         js->text_value=unescape_string(p, &p, encoder);
         if (!js->text_value) return 0; // propagate error
         return p;
       case '-': case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
         {
-          js=create_json(NX_JSON_INTEGER, key, parent);
+          js=create_json(NX_JSON_INTEGER, key, parent, allocator);
           char* pe;
           js->int_value=strtoll(p, &pe, 0);
           if (pe==p || errno==ERANGE) {
@@ -292,7 +297,7 @@ static char* parse_value(nx_json* parent, const char* key, char* p, nx_json_unic
         }
       case 't':
         if (!strncmp(p, "true", 4)) {
-          js=create_json(NX_JSON_BOOL, key, parent);
+          js=create_json(NX_JSON_BOOL, key, parent, allocator);
           js->int_value=1;
           return p+4;
         }
@@ -300,7 +305,7 @@ static char* parse_value(nx_json* parent, const char* key, char* p, nx_json_unic
         return 0; // error
       case 'f':
         if (!strncmp(p, "false", 5)) {
-          js=create_json(NX_JSON_BOOL, key, parent);
+          js=create_json(NX_JSON_BOOL, key, parent, allocator);
           js->int_value=0;
           return p+5;
         }
@@ -308,7 +313,7 @@ static char* parse_value(nx_json* parent, const char* key, char* p, nx_json_unic
         return 0; // error
       case 'n':
         if (!strncmp(p, "null", 4)) {
-          create_json(NX_JSON_NULL, key, parent);
+          create_json(NX_JSON_NULL, key, parent, allocator);
           return p+4;
         }
         NX_JSON_REPORT_ERROR("unexpected chars", p);
@@ -344,10 +349,14 @@ const nx_json* nx_json_parse_utf8(char* text) {
 }
 
 const nx_json* nx_json_parse(char* text, nx_json_unicode_encoder encoder) {
+  return nx_json_parse_alloc(text, encoder, 0);
+}
+
+const nx_json* nx_json_parse_alloc(char* text, nx_json_unicode_encoder encoder, const nx_json_allocator* allocator) {
   nx_json js={0};
   char* locale = setlocale(LC_ALL, "C");
-  if (!parse_value(&js, 0, text, encoder)) {
-    if (js.child) nx_json_free(js.child);
+  if (!parse_value(&js, 0, text, encoder, allocator)) {
+    if (js.child) nx_json_free_alloc(js.child, allocator);
     setlocale(LC_ALL, locale);
     return 0;
   }
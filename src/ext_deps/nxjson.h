@@ -10,6 +10,8 @@
 #ifndef NXJSON_H
 #define NXJSON_H
 
+#include <stddef.h>
+
 #ifdef  __cplusplus
 extern "C" {
 #endif
@@ -40,11 +42,20 @@ typedef struct nx_json {
 
 typedef int (*nx_json_unicode_encoder)(unsigned int codepoint, char* p, char** endp);
 
+typedef struct nx_json_allocator {
+  void* (*alloc)(void* user_data, size_t size); // must return zeroed memory
+  void (*free)(void* user_data, void* ptr);
+  void* user_data;
+} nx_json_allocator;
+
 extern nx_json_unicode_encoder nx_json_unicode_to_utf8;
 
 const nx_json* nx_json_parse(char* text, nx_json_unicode_encoder encoder);
 const nx_json* nx_json_parse_utf8(char* text);
 void nx_json_free(const nx_json* js);
+// nodes are allocated with allocator, must be freed with nx_json_free_alloc using the same allocator
+const nx_json* nx_json_parse_alloc(char* text, nx_json_unicode_encoder encoder, const nx_json_allocator* allocator);
+void nx_json_free_alloc(const nx_json* js, const nx_json_allocator* allocator);
 const nx_json* nx_json_get(const nx_json* json, const char* key); // get object's property by key
 const nx_json* nx_json_item(const nx_json* json, int idx); // get array element by index
 
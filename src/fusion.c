@@ -125,3 +125,9 @@ void ofusion_update(fusion* me, float dt, const vec3f* ang_vel, const vec3f* acc
 	// inprecision with quat multiplication.
 	oquatf_normalize_me(&me->orient);
 }
+
+void ofusion_update_batch(fusion* me, const fusion_sample* samples, int count, const vec3f* mag)
+{
+	for(int i = 0; i < count; i++)
+		ofusion_update(me, samples[i].dt, &samples[i].ang_vel, &samples[i].accel, mag);
+}
@@ -39,7 +39,14 @@ typedef struct {
 	float grav_gain; // amount of correction
 } fusion;
 
+typedef struct {
+	float dt;
+	vec3f ang_vel;
+	vec3f accel;
+} fusion_sample;
+
 void ofusion_init(fusion* me);
 void ofusion_update(fusion* me, float dt, const vec3f* ang_vel, const vec3f* accel, const vec3f* mag_field);
+void ofusion_update_batch(fusion* me, const fusion_sample* samples, int count, const vec3f* mag_field);
 
 #endif
@@ -8,7 +8,7 @@
 #ifndef OPENHMD_HID_H
 #define OPENHMD_HID_H
 
-static inline char* _hid_to_unix_path(char* path)
+static inline char* _hid_to_unix_path(const char* path)
 {
 	char bus [5];
 	char dev [5];
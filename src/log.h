@@ -13,6 +13,9 @@
 
 void* ohmd_allocfn(ohmd_context* ctx, const char* e_msg, size_t size);
 #define ohmd_alloc(_ctx, _size) ohmd_allocfn(_ctx, "could not allocate " #_size " bytes of RAM @ " __FILE__ ":" OHMD_STRINGIFY(__LINE__), _size)
+// frees memory from ohmd_alloc, the owning context is stored with the allocation
+void ohmd_free(void* ptr);
+void* ohmd_realloc(ohmd_context* ctx, void* ptr, size_t size);
 
 #ifndef LOGLEVEL
 #define LOGLEVEL 2
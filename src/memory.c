@@ -0,0 +1,227 @@
+// Copyright 2026, OpenHMD contributors.
+// SPDX-License-Identifier: BSL-1.0
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ */
+
+/* Memory Allocation and Arenas */
+
+
+#include <string.h>
+#include "openhmdi.h"
+#include "ext_deps/nxjson.h"
+
+// Every allocation is prefixed with a header so it can be freed and accounted without a context pointer.
+// The header is padded to 16 bytes to keep the returned memory suitably aligned for any type.
+#define ALLOC_HEADER_SIZE 16
+
+typedef struct {
+	ohmd_context* ctx;
+	size_t size;
+} alloc_header;
+
+typedef char alloc_header_fits[sizeof(alloc_header) <= ALLOC_HEADER_SIZE ? 1 : -1];
+
+static void* OHMD_APIENTRY default_alloc(size_t size, void* user_data)
+{
+	return malloc(size);
+}
+
+static void OHMD_APIENTRY default_free(void* ptr, void* user_data)
+{
+	free(ptr);
+}
+
+void ohmd_memory_init(ohmd_context* ctx, const ohmd_allocator* allocator)
+{
+	if(allocator){
+		ctx->allocator = *allocator;
+	}else{
+		ctx->allocator.alloc = default_alloc;
+		ctx->allocator.free = default_free;
+		ctx->allocator.user_data = NULL;
+	}
+}
+
+void* ohmd_allocfn(ohmd_context* ctx, const char* e_msg, size_t size)
+{
+	unsigned char* raw = ctx->allocator.alloc(size + ALLOC_HEADER_SIZE, ctx->allocator.user_data);
+	if(!raw){
+		ohmd_set_error(ctx, "%s", e_msg);
+		return NULL;
+	}
+
+	memset(raw, 0, size + ALLOC_HEADER_SIZE);
+
+	alloc_header* h = (alloc_header*)raw;
+	h->ctx = ctx;
+	h->size = size;
+
+	uint64_t current = ohmd_atomic_add_u64(&ctx->mem_current, (int64_t)size);
+	ohmd_atomic_max_u64(&ctx->mem_peak, current);
+	ohmd_atomic_add_u64(&ctx->mem_allocations, 1);
+
+	return raw + ALLOC_HEADER_SIZE;
+}
+
+void ohmd_free(void* ptr)
+{
+	if(!ptr)
+		return;
+
+	unsigned char* raw = (unsigned char*)ptr - ALLOC_HEADER_SIZE;
+	alloc_header* h = (alloc_header*)raw;
+	ohmd_context* ctx = h->ctx;
+
+	ohmd_atomic_add_u64(&ctx->mem_current, -(int64_t)h->size);
+	ctx->allocator.free(raw, ctx->allocator.user_data);
+}
+
+// Detached allocations may outlive their context, so the header keeps the allocator instead.
+// They are not accounted in the context's memory stats.
+typedef struct {
+	void (OHMD_APIENTRY *free)(void* ptr, void* user_data);
+	void* user_data;
+} detached_header;
+
+typedef char detached_header_fits[sizeof(detached_header) <= ALLOC_HEADER_SIZE ? 1 : -1];
+
+void* ohmd_alloc_detached(ohmd_context* ctx, size_t size)
+{
+	unsigned char* raw = ctx->allocator.alloc(size + ALLOC_HEADER_SIZE, ctx->allocator.user_data);
+	if(!raw){
+		ohmd_set_error(ctx, "could not allocate %u bytes of RAM", (unsigned)size);
+		return NULL;
+	}
+
+	memset(raw, 0, size + ALLOC_HEADER_SIZE);
+
+	detached_header* h = (detached_header*)raw;
+	h->free = ctx->allocator.free;
+	h->user_data = ctx->allocator.user_data;
+
+	return raw + ALLOC_HEADER_SIZE;
+}
+
+void ohmd_free_detached(void* ptr)
+{
+	if(!ptr)
+		return;
+
+	unsigned char* raw = (unsigned char*)ptr - ALLOC_HEADER_SIZE;
+	detached_header* h = (detached_header*)raw;
+
+	h->free(raw, h->user_data);
+}
+
+void* ohmd_realloc(ohmd_context* ctx, void* ptr, size_t size)
+{
+	void* out = ohmd_alloc(ctx, size);
+	if(!out)
+		return NULL;
+
+	if(ptr){
+		alloc_header* h = (alloc_header*)((unsigned char*)ptr - ALLOC_HEADER_SIZE);
+		memcpy(out, ptr, OHMD_MIN(h->size, size));
+		ohmd_free(ptr);
+	}
+
+	return out;
+}
+
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_ctx_get_memory_stats(ohmd_context* ctx, ohmd_memory_stats* out, int reset_peak)
+{
+	uint64_t current = ohmd_atomic_add_u64(&ctx->mem_current, 0);
+
+	out->current_bytes = (size_t)current;
+	out->peak_bytes = (size_t)ohmd_atomic_add_u64(&ctx->mem_peak, 0);
+	out->num_allocations = (size_t)ohmd_atomic_add_u64(&ctx->mem_allocations, 0);
+
+	if(reset_peak)
+		ohmd_atomic_store_u64(&ctx->mem_peak, current);
+
+	return OHMD_S_OK;
+}
+
+// Arenas
+
+#define ARENA_DEFAULT_BLOCK_SIZE 4096
+#define ARENA_ALIGN 16
+
+struct ohmd_arena_block {
+	ohmd_arena_block* next;
+	size_t size;
+	size_t used;
+};
+
+#define ARENA_BLOCK_HEADER_SIZE ((sizeof(ohmd_arena_block) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+#define ARENA_BLOCK_DATA(_b) ((unsigned char*)(_b) + ARENA_BLOCK_HEADER_SIZE)
+
+void ohmd_arena_init(ohmd_arena* arena, ohmd_context* ctx, size_t block_size)
+{
+	arena->ctx = ctx;
+	arena->blocks = NULL;
+	arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+}
+
+void* ohmd_arena_alloc(ohmd_arena* arena, size_t size)
+{
+	size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+	ohmd_arena_block* block = arena->blocks;
+	if(!block || block->size - block->used < size){
+		// big allocations get a block of their own
+		size_t block_size = OHMD_MAX(arena->block_size, size);
+
+		block = ohmd_alloc(arena->ctx, ARENA_BLOCK_HEADER_SIZE + block_size);
+		if(!block)
+			return NULL;
+
+		block->size = block_size;
+		block->used = 0;
+
+		// a block filled by a single allocation goes behind the head, which may still have room
+		if(arena->blocks && block_size == size){
+			block->next = arena->blocks->next;
+			arena->blocks->next = block;
+		}else{
+			block->next = arena->blocks;
+			arena->blocks = block;
+		}
+	}
+
+	// blocks come cleared from ohmd_alloc and are never reused
+	void* out = ARENA_BLOCK_DATA(block) + block->used;
+	block->used += size;
+
+	return out;
+}
+
+void ohmd_arena_release(ohmd_arena* arena)
+{
+	ohmd_arena_block* block = arena->blocks;
+	while(block){
+		ohmd_arena_block* next = block->next;
+		ohmd_free(block);
+		block = next;
+	}
+
+	arena->blocks = NULL;
+}
+
+static void* json_arena_alloc(void* user_data, size_t size)
+{
+	return ohmd_arena_alloc((ohmd_arena*)user_data, size);
+}
+
+static void json_arena_free(void* user_data, void* ptr)
+{
+	// released together with the arena
+}
+
+void ohmd_arena_json_allocator(ohmd_arena* arena, nx_json_allocator* out)
+{
+	out->alloc = json_arena_alloc;
+	out->free = json_arena_free;
+	out->user_data = arena;
+}
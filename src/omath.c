@@ -366,6 +366,33 @@ void omat4x4f_mult(const mat4x4f* l, const mat4x4f* r, mat4x4f *o)
 	}
 }
 
+void omat3x4f_init_rectify(mat3x4f* me, const float* rot, float scale, const vec3f* offset)
+{
+	// rot * (scale * v - offset) = (scale * rot) * v - rot * offset
+	for(int i = 0; i < 3; i++){
+		const float* r = rot + i * 3;
+		me->m[i][0] = scale * r[0];
+		me->m[i][1] = scale * r[1];
+		me->m[i][2] = scale * r[2];
+		me->m[i][3] = -(r[0] * offset->x + r[1] * offset->y + r[2] * offset->z);
+	}
+}
+
+void omat3x4f_transform(const mat3x4f* me, const vec3f* in, vec3f* out, int count)
+{
+	// the matrix is loaded once for the whole batch, in and out may be the same array
+	const float m00 = me->m[0][0], m01 = me->m[0][1], m02 = me->m[0][2], m03 = me->m[0][3];
+	const float m10 = me->m[1][0], m11 = me->m[1][1], m12 = me->m[1][2], m13 = me->m[1][3];
+	const float m20 = me->m[2][0], m21 = me->m[2][1], m22 = me->m[2][2], m23 = me->m[2][3];
+
+	for(int i = 0; i < count; i++){
+		float x = in[i].x, y = in[i].y, z = in[i].z;
+		out[i].x = m00 * x + m01 * y + m02 * z + m03;
+		out[i].y = m10 * x + m11 * y + m12 * z + m13;
+		out[i].z = m20 * x + m21 * y + m22 * z + m23;
+	}
+}
+
 
 // filter queue
 
@@ -75,6 +75,16 @@ void omat4x4f_init_translate(mat4x4f* me, float x, float y, float z);
 void omat4x4f_mult(const mat4x4f* left, const mat4x4f* right, mat4x4f* out_mat);
 void omat4x4f_transpose(const mat4x4f* me, mat4x4f* out_mat);
 
+// affine transform, a 3x3 matrix in the first three columns and a translation in the last
+typedef union {
+	float m[3][4];
+	float arr[12];
+} mat3x4f;
+
+// builds the transform of v to rot * (scale * v - offset), rot is a row-major 3x3 matrix
+void omat3x4f_init_rectify(mat3x4f* me, const float* rot, float scale, const vec3f* offset);
+void omat3x4f_transform(const mat3x4f* me, const vec3f* in, vec3f* out, int count);
+
 
 // filter queue
 #define FILTER_QUEUE_MAX_SIZE 256
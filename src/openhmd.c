@@ -16,17 +16,30 @@
 
 // Running automatic updates at 1000 Hz
 #define AUTOMATIC_UPDATE_SLEEP (1.0 / 1000.0)
+// or waiting up to this long for input when every device has input fds
+#define AUTOMATIC_UPDATE_WAIT (10.0 / 1000.0)
+#define MAX_WAIT_FDS 32
 
 OHMD_APIENTRYDLL ohmd_context* OHMD_APIENTRY ohmd_ctx_create(void)
 {
-	ohmd_context* ctx = calloc(1, sizeof(ohmd_context));
+	return ohmd_ctx_create_with_allocator(NULL);
+}
+
+OHMD_APIENTRYDLL ohmd_context* OHMD_APIENTRY ohmd_ctx_create_with_allocator(const ohmd_allocator* allocator)
+{
+	ohmd_context* ctx = allocator ? allocator->alloc(sizeof(ohmd_context), allocator->user_data) : malloc(sizeof(ohmd_context));
 	if(!ctx){
 		LOGE("could not allocate RAM for context");
 		return NULL;
 	}
 
+	memset(ctx, 0, sizeof(ohmd_context));
+
+	ohmd_memory_init(ctx, allocator);
 	ohmd_monotonic_init(ctx);
 
+	ohmd_arena_init(&ctx->list.strings, ctx, 0);
+
 #if DRIVER_OCULUS_RIFT
 	ctx->drivers[ctx->num_drivers++] = ohmd_create_oculus_rift_drv(ctx);
 #endif
@@ -75,6 +88,10 @@ OHMD_APIENTRYDLL ohmd_context* OHMD_APIENTRY ohmd_ctx_create(void)
 
 	ctx->update_request_quit = false;
 
+	// created up front so ohmd_device_wait_pose works without the update thread
+	ctx->update_mutex = ohmd_create_mutex(ctx);
+	ctx->pose_cond = ohmd_create_cond(ctx);
+
 	return ctx;
 }
 
@@ -82,6 +99,10 @@ OHMD_APIENTRYDLL void OHMD_APIENTRY ohmd_ctx_destroy(ohmd_context* ctx)
 {
 	ctx->update_request_quit = true;
 
+	// stop the update thread before the devices it updates go away
+	if(ctx->update_thread)
+		ohmd_destroy_thread(ctx->update_thread);
+
 	for(int i = 0; i < ctx->num_active_devices; i++){
 		ctx->active_devices[i]->close(ctx->active_devices[i]);
 	}
@@ -90,26 +111,86 @@ OHMD_APIENTRYDLL void OHMD_APIENTRY ohmd_ctx_destroy(ohmd_context* ctx)
 		ctx->drivers[i]->destroy(ctx->drivers[i]);
 	}
 
-	if(ctx->update_thread){
-		ohmd_destroy_thread(ctx->update_thread);
-		ohmd_destroy_mutex(ctx->update_mutex);
-	}
+	ohmd_device_list_clear(&ctx->list);
+	ohmd_free(ctx->list.devices);
+	ohmd_free(ctx->active_devices);
+
+	ohmd_destroy_cond(ctx->pose_cond);
+	ohmd_destroy_mutex(ctx->update_mutex);
 
-	free(ctx);
+	if(ctx->mem_current != 0)
+		LOGW("%llu bytes still allocated when destroying context", (unsigned long long)ctx->mem_current);
+
+	ohmd_allocator allocator = ctx->allocator;
+	allocator.free(ctx, allocator.user_data);
+}
+
+// Must be called with update_mutex held, returns true if the pose of dev changed since the last call.
+static bool ohmd_check_pose(ohmd_device* dev)
+{
+	quatf rot;
+	vec3f pos;
+
+	if(dev->getf(dev, OHMD_ROTATION_QUAT, (float*)&rot) != OHMD_S_OK ||
+	   dev->getf(dev, OHMD_POSITION_VECTOR, (float*)&pos) != OHMD_S_OK)
+		return false;
+
+	if(memcmp(&rot, &dev->pose_rotation, sizeof(rot)) == 0 && memcmp(&pos, &dev->pose_position, sizeof(pos)) == 0)
+		return false;
+
+	dev->pose_rotation = rot;
+	dev->pose_position = pos;
+	dev->pose_seq++;
+
+	return true;
+}
+
+// Must be called with update_mutex held, unlocks it before calling the pose callback.
+static void ohmd_notify_pose_and_unlock(ohmd_context* ctx, bool changed)
+{
+	ohmd_pose_callback callback = ctx->pose_callback;
+	void* user_data = ctx->pose_callback_data;
+
+	if(changed)
+		ohmd_cond_broadcast(ctx->pose_cond);
+
+	ohmd_unlock_mutex(ctx->update_mutex);
+
+	if(changed && callback)
+		callback(ctx, user_data);
 }
 
 OHMD_APIENTRYDLL void OHMD_APIENTRY ohmd_ctx_update(ohmd_context* ctx)
 {
+	bool changed = false;
+
 	for(int i = 0; i < ctx->num_active_devices; i++){
 		ohmd_device* dev = ctx->active_devices[i];
+
+		// under the lock like the update thread, so what the driver publishes is seen whole
+		ohmd_lock_mutex(ctx->update_mutex);
 		if(!dev->settings.automatic_update && dev->update)
 			dev->update(dev);
 
-		ohmd_lock_mutex(ctx->update_mutex);
 		dev->getf(dev, OHMD_POSITION_VECTOR, (float*)&dev->position);
 		dev->getf(dev, OHMD_ROTATION_QUAT, (float*)&dev->rotation);
+		if(!dev->settings.automatic_update && ohmd_check_pose(dev))
+			changed = true;
 		ohmd_unlock_mutex(ctx->update_mutex);
 	}
+
+	ohmd_lock_mutex(ctx->update_mutex);
+	ohmd_notify_pose_and_unlock(ctx, changed);
+}
+
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_ctx_set_pose_callback(ohmd_context* ctx, ohmd_pose_callback callback, void* user_data)
+{
+	ohmd_lock_mutex(ctx->update_mutex);
+	ctx->pose_callback = callback;
+	ctx->pose_callback_data = user_data;
+	ohmd_unlock_mutex(ctx->update_mutex);
+
+	return OHMD_S_OK;
 }
 
 OHMD_APIENTRYDLL const char* OHMD_APIENTRY ohmd_ctx_get_error(ohmd_context* ctx)
@@ -119,11 +200,29 @@ OHMD_APIENTRYDLL const char* OHMD_APIENTRY ohmd_ctx_get_error(ohmd_context* ctx)
 
 OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_ctx_probe(ohmd_context* ctx)
 {
-	memset(&ctx->list, 0, sizeof(ohmd_device_list));
+	ohmd_device_list_clear(&ctx->list);
 	for(int i = 0; i < ctx->num_drivers; i++){
 		ctx->drivers[i]->get_device_list(ctx->drivers[i], &ctx->list);
 	}
 
+	// Devices from the same driver on the same path are parts of one physical device
+	int num_groups = 0;
+	for(int i = 0; i < ctx->list.num_devices; i++){
+		ohmd_device_desc* desc = &ctx->list.devices[i];
+		desc->group = -1;
+
+		for(int j = 0; j < i; j++){
+			ohmd_device_desc* other = &ctx->list.devices[j];
+			if(other->driver_ptr == desc->driver_ptr && strcmp(other->path, desc->path) == 0){
+				desc->group = other->group;
+				break;
+			}
+		}
+
+		if(desc->group < 0)
+			desc->group = num_groups++;
+	}
+
 	return ctx->list.num_devices;
 }
 
@@ -155,7 +254,7 @@ OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_gets(ohmd_string_description type, const
 
 OHMD_APIENTRYDLL const char* OHMD_APIENTRY ohmd_list_gets(ohmd_context* ctx, int index, ohmd_string_value type)
 {
-	if(index >= ctx->list.num_devices)
+	if(index < 0 || index >= ctx->list.num_devices)
 		return NULL;
 
 	switch(type){
@@ -172,7 +271,7 @@ OHMD_APIENTRYDLL const char* OHMD_APIENTRY ohmd_list_gets(ohmd_context* ctx, int
 
 OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_list_geti(ohmd_context* ctx, int index, ohmd_int_value type, int* out)
 {
-	if(index >= ctx->list.num_devices)
+	if(index < 0 || index >= ctx->list.num_devices)
 		return OHMD_S_INVALID_PARAMETER;
 
 	switch(type){
@@ -184,6 +283,10 @@ OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_list_geti(ohmd_context* ctx, int index,
 		*out = ctx->list.devices[index].device_flags;
 		return OHMD_S_OK;
 
+	case OHMD_DEVICE_GROUP:
+		*out = ctx->list.devices[index].group;
+		return OHMD_S_OK;
+
 	default:
 		return OHMD_S_INVALID_PARAMETER;
 	}
@@ -195,16 +298,34 @@ static unsigned int ohmd_update_thread(void* arg)
 
 	while(!ctx->update_request_quit)
 	{
+		bool changed = false;
+		int fds[MAX_WAIT_FDS];
+		int num_fds = 0;
+		bool can_wait = true;
+
 		ohmd_lock_mutex(ctx->update_mutex);
 
 		for(int i = 0; i < ctx->num_active_devices; i++){
-			if(ctx->active_devices[i]->settings.automatic_update && ctx->active_devices[i]->update)
-				ctx->active_devices[i]->update(ctx->active_devices[i]);
+			ohmd_device* dev = ctx->active_devices[i];
+			if(dev->settings.automatic_update && dev->update){
+				dev->update(dev);
+				if(ohmd_check_pose(dev))
+					changed = true;
+
+				int n = dev->get_wait_fds ? dev->get_wait_fds(dev, fds + num_fds, MAX_WAIT_FDS - num_fds) : 0;
+				if(n > 0)
+					num_fds += n;
+				else
+					can_wait = false;
+			}
 		}
 
-		ohmd_unlock_mutex(ctx->update_mutex);
+		ohmd_notify_pose_and_unlock(ctx, changed);
 
-		ohmd_sleep(AUTOMATIC_UPDATE_SLEEP);
+		// sleep until there's input if no device needs polling, fall back to
+		// polling when an fd fails so a device that went away can't spin this loop
+		if(!can_wait || num_fds == 0 || ohmd_wait_fds(fds, num_fds, AUTOMATIC_UPDATE_WAIT) < 0)
+			ohmd_sleep(AUTOMATIC_UPDATE_SLEEP);
 	}
 
 	return 0;
@@ -213,38 +334,73 @@ static unsigned int ohmd_update_thread(void* arg)
 static void ohmd_set_up_update_thread(ohmd_context* ctx)
 {
 	if(!ctx->update_thread){
-		ctx->update_mutex = ohmd_create_mutex(ctx);
 		ctx->update_thread = ohmd_create_thread(ctx, ohmd_update_thread, ctx);
 	}
 }
 
-OHMD_APIENTRYDLL ohmd_device* OHMD_APIENTRY ohmd_list_open_device_s(ohmd_context* ctx, int index, ohmd_device_settings* settings)
+// Must be called with update_mutex held.
+static ohmd_device* ohmd_open_device_locked(ohmd_context* ctx, int index, ohmd_device_settings* settings)
 {
-	ohmd_lock_mutex(ctx->update_mutex);
+	if(ctx->num_active_devices == ctx->max_active_devices){
+		int max = OHMD_MAX(16, ctx->max_active_devices * 2);
+		ohmd_device** devices = ohmd_realloc(ctx, ctx->active_devices, sizeof(ohmd_device*) * max);
+		if(!devices){
+			ohmd_set_error(ctx, "could not allocate RAM for %d active devices", max);
+			return NULL;
+		}
 
-	if(index >= 0 && index < ctx->list.num_devices){
+		ctx->active_devices = devices;
+		ctx->max_active_devices = max;
+	}
 
-		ohmd_device_desc* desc = &ctx->list.devices[index];
-		ohmd_driver* driver = (ohmd_driver*)desc->driver_ptr;
-		ohmd_device* device = driver->open_device(driver, desc);
+	ohmd_device_desc* desc = &ctx->list.devices[index];
+	ohmd_driver* driver = (ohmd_driver*)desc->driver_ptr;
+	ohmd_device* device = driver->open_device(driver, desc);
 
-		if (device == NULL) {
-			ohmd_set_error(ctx, "Could not open device with index: %d, check device permissions?", index);
-			ohmd_unlock_mutex(ctx->update_mutex);
-			return NULL;
-		}
+	if (device == NULL) {
+		ohmd_set_error(ctx, "Could not open device with index: %d, check device permissions?", index);
+		return NULL;
+	}
+
+	device->rotation_correction.w = 1;
+
+	device->settings = *settings;
 
-		device->rotation_correction.w = 1;
+	device->ctx = ctx;
+	device->group = desc->group;
+	device->active_device_idx = ctx->num_active_devices;
+	ctx->active_devices[ctx->num_active_devices++] = device;
 
-		device->settings = *settings;
+	return device;
+}
+
+// Must be called with update_mutex held.
+static void ohmd_close_device_locked(ohmd_device* device)
+{
+	ohmd_context* ctx = device->ctx;
+	int idx = device->active_device_idx;
+
+	memmove(ctx->active_devices + idx, ctx->active_devices + idx + 1,
+		sizeof(ohmd_device*) * (ctx->num_active_devices - idx - 1));
+
+	device->close(device);
+
+	ctx->num_active_devices--;
+
+	for(int i = idx; i < ctx->num_active_devices; i++)
+		ctx->active_devices[i]->active_device_idx--;
+}
+
+OHMD_APIENTRYDLL ohmd_device* OHMD_APIENTRY ohmd_list_open_device_s(ohmd_context* ctx, int index, ohmd_device_settings* settings)
+{
+	ohmd_lock_mutex(ctx->update_mutex);
 
-		device->ctx = ctx;
-		device->active_device_idx = ctx->num_active_devices;
-		ctx->active_devices[ctx->num_active_devices++] = device;
+	if(index >= 0 && index < ctx->list.num_devices){
+		ohmd_device* device = ohmd_open_device_locked(ctx, index, settings);
 
 		ohmd_unlock_mutex(ctx->update_mutex);
 
-		if(device->settings.automatic_update)
+		if(device && device->settings.automatic_update)
 			ohmd_set_up_update_thread(ctx);
 
 		return device;
@@ -256,9 +412,64 @@ OHMD_APIENTRYDLL ohmd_device* OHMD_APIENTRY ohmd_list_open_device_s(ohmd_context
 	return NULL;
 }
 
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_list_open_device_group(ohmd_context* ctx, int index, ohmd_device_settings* settings, ohmd_device** out, int max_devices)
+{
+	if(index < 0 || index >= ctx->list.num_devices){
+		ohmd_set_error(ctx, "no device with index: %d", index);
+		return OHMD_S_INVALID_PARAMETER;
+	}
+
+	ohmd_device_settings default_settings = {0};
+	if(settings == NULL){
+		default_settings.automatic_update = true;
+		settings = &default_settings;
+	}
+
+	int group = ctx->list.devices[index].group;
+	int count = 0;
+	bool failed = false;
+
+	ohmd_lock_mutex(ctx->update_mutex);
+
+	for(int i = 0; i < ctx->list.num_devices; i++){
+		if(ctx->list.devices[i].group != group)
+			continue;
+
+		if(count >= max_devices){
+			ohmd_set_error(ctx, "device group of index %d has more than %d devices", index, max_devices);
+			failed = true;
+			break;
+		}
+
+		out[count] = ohmd_open_device_locked(ctx, i, settings);
+		if(out[count] == NULL){
+			failed = true;
+			break;
+		}
+
+		count++;
+	}
+
+	if(failed){
+		// Don't leave a partially opened group behind
+		for(int i = count - 1; i >= 0; i--)
+			ohmd_close_device_locked(out[i]);
+
+		ohmd_unlock_mutex(ctx->update_mutex);
+		return OHMD_S_UNKNOWN_ERROR;
+	}
+
+	ohmd_unlock_mutex(ctx->update_mutex);
+
+	if(settings->automatic_update)
+		ohmd_set_up_update_thread(ctx);
+
+	return count;
+}
+
 OHMD_APIENTRYDLL ohmd_device* OHMD_APIENTRY ohmd_list_open_device(ohmd_context* ctx, int index)
 {
-	ohmd_device_settings settings;
+	ohmd_device_settings settings = {0};
 
 	settings.automatic_update = true;
 
@@ -267,21 +478,10 @@ OHMD_APIENTRYDLL ohmd_device* OHMD_APIENTRY ohmd_list_open_device(ohmd_context*
 
 OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_close_device(ohmd_device* device)
 {
-	ohmd_lock_mutex(device->ctx->update_mutex);
-
 	ohmd_context* ctx = device->ctx;
-	int idx = device->active_device_idx;
-
-	memmove(ctx->active_devices + idx, ctx->active_devices + idx + 1,
-		sizeof(ohmd_device*) * (ctx->num_active_devices - idx - 1));
-
-	device->close(device);
-
-	ctx->num_active_devices--;
-
-	for(int i = idx; i < ctx->num_active_devices; i++)
-		ctx->active_devices[i]->active_device_idx--;
 
+	ohmd_lock_mutex(ctx->update_mutex);
+	ohmd_close_device_locked(device);
 	ohmd_unlock_mutex(ctx->update_mutex);
 
 	return OHMD_S_OK;
@@ -378,6 +578,34 @@ static int ohmd_device_getf_unp(ohmd_device* device, ohmd_float_value type, floa
 		}
 		return OHMD_S_OK;
 	}
+	case OHMD_TRACKING_SENSOR_MODEL: {
+		// the model can appear after the application sized its buffer from the count
+		int count = OHMD_MIN(device->properties.tracking_sensor_count, device->tracking_sensors_reported);
+		for (int i = 0; i < count; i++) {
+			const ohmd_tracking_sensor* sensor = &device->properties.tracking_sensors[i];
+			memcpy(out + i * 6, sensor->position.arr, sizeof(float) * 3);
+			memcpy(out + i * 6 + 3, sensor->normal.arr, sizeof(float) * 3);
+		}
+		return OHMD_S_OK;
+	}
+	case OHMD_CAMERA_CALIBRATION: {
+		for (int i = 0; i < device->properties.camera_count; i++) {
+			const ohmd_camera_calibration* cam = &device->properties.cameras[i];
+			float* o = out + i * 27;
+			o[0] = (float)cam->model;
+			o[1] = (float)cam->width;
+			o[2] = (float)cam->height;
+			o[3] = cam->fx;
+			o[4] = cam->fy;
+			o[5] = cam->cx;
+			o[6] = cam->cy;
+			memcpy(o + 7, cam->k, sizeof(float) * 6);
+			memcpy(o + 13, cam->p, sizeof(float) * 2);
+			memcpy(o + 15, cam->rotation, sizeof(float) * 9);
+			memcpy(o + 24, cam->translation.arr, sizeof(float) * 3);
+		}
+		return OHMD_S_OK;
+	}
 	default:
 		return device->getf(device, type, out);
 	}
@@ -453,7 +681,7 @@ OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_setf(ohmd_device* device, ohmd_fl
 	return ret;
 }
 
-OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_geti(ohmd_device* device, ohmd_int_value type, int* out)
+static int ohmd_device_geti_unp(ohmd_device* device, ohmd_int_value type, int* out)
 {
 	switch(type){
 		case OHMD_SCREEN_HORIZONTAL_RESOLUTION:
@@ -468,6 +696,24 @@ OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_geti(ohmd_device* device, ohmd_in
 			*out = device->properties.control_count;
 			return OHMD_S_OK;
 
+		case OHMD_DEVICE_GROUP:
+			*out = device->group;
+			return OHMD_S_OK;
+
+		case OHMD_TRACKING_SENSOR_COUNT:
+			device->tracking_sensors_reported = device->properties.tracking_sensor_count;
+			*out = device->tracking_sensors_reported;
+			return OHMD_S_OK;
+
+		case OHMD_CAMERA_COUNT:
+			*out = device->properties.camera_count;
+			return OHMD_S_OK;
+
+		case OHMD_SAMPLE_STATS:
+			out[0] = (int)ohmd_atomic_load_u32(&device->sample_stats.received);
+			out[1] = (int)ohmd_atomic_load_u32(&device->sample_stats.dropped);
+			return OHMD_S_OK;
+
 		case OHMD_CONTROLS_TYPES:
 			memcpy(out, device->properties.controls_types, device->properties.control_count * sizeof(int));
 			return OHMD_S_OK;
@@ -476,11 +722,30 @@ OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_geti(ohmd_device* device, ohmd_in
 			memcpy(out, device->properties.controls_hints, device->properties.control_count * sizeof(int));
 			return OHMD_S_OK;
 
+		case OHMD_TRACKING_SENSOR_PATTERNS: {
+			int count = OHMD_MIN(device->properties.tracking_sensor_count, device->tracking_sensors_reported);
+			for (int i = 0; i < count; i++)
+				out[i] = (int)device->properties.tracking_sensors[i].pattern;
+			return OHMD_S_OK;
+		}
+
 		default:
+			if (!device->geti)
 				return OHMD_S_INVALID_PARAMETER;
+
+			return device->geti(device, type, out);
 	}
 }
 
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_geti(ohmd_device* device, ohmd_int_value type, int* out)
+{
+	ohmd_lock_mutex(device->ctx->update_mutex);
+	int ret = ohmd_device_geti_unp(device, type, out);
+	ohmd_unlock_mutex(device->ctx->update_mutex);
+
+	return ret;
+}
+
 OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_seti(ohmd_device* device, ohmd_int_value type, const int* in)
 {
 	switch(type){
@@ -515,6 +780,56 @@ OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_set_data(ohmd_device* device, ohm
 	return ret;
 }
 
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_get_control_events(ohmd_device* device, ohmd_control_event* out, int max_events)
+{
+	if(max_events < 0)
+		return OHMD_S_INVALID_PARAMETER;
+
+	ohmd_control_event_queue* q = &device->control_events;
+	uint32_t tail = q->tail;
+	uint32_t head = ohmd_atomic_load_u32(&q->head);
+	int count = 0;
+
+	while(tail != head && count < max_events){
+		out[count++] = q->events[tail % OHMD_MAX_CONTROL_EVENTS];
+		tail++;
+	}
+
+	ohmd_atomic_store_u32(&q->tail, tail);
+
+	return count;
+}
+
+OHMD_APIENTRYDLL int OHMD_APIENTRY ohmd_device_wait_pose(ohmd_device* device, unsigned int last_seq, double timeout, unsigned int* out_seq)
+{
+	if(timeout < 0)
+		return OHMD_S_INVALID_PARAMETER;
+
+	ohmd_context* ctx = device->ctx;
+	double deadline = ohmd_get_tick() + timeout;
+	int ret = OHMD_S_OK;
+
+	ohmd_lock_mutex(ctx->update_mutex);
+
+	while(device->pose_seq == last_seq){
+		double remaining = deadline - ohmd_get_tick();
+		if(remaining <= 0){
+			ret = OHMD_S_TIMEOUT;
+			break;
+		}
+
+		// wakeups can be spurious or for another device, so re-check after each one
+		ohmd_cond_wait(ctx->pose_cond, ctx->update_mutex, remaining);
+	}
+
+	if(out_seq)
+		*out_seq = device->pose_seq;
+
+	ohmd_unlock_mutex(ctx->update_mutex);
+
+	return ret;
+}
+
 OHMD_APIENTRYDLL ohmd_status OHMD_APIENTRY ohmd_device_settings_seti(ohmd_device_settings* settings, ohmd_int_settings key, const int* val)
 {
 	switch(key){
@@ -522,6 +837,14 @@ OHMD_APIENTRYDLL ohmd_status OHMD_APIENTRY ohmd_device_settings_seti(ohmd_device
 		settings->automatic_update = val[0] == 0 ? false : true;
 		return OHMD_S_OK;
 
+	case OHMD_IDS_HIGH_RATE_SENSORS:
+		settings->high_rate_sensors = val[0] == 0 ? false : true;
+		return OHMD_S_OK;
+
+	case OHMD_IDS_TEMPERATURE_CALIBRATION:
+		settings->temperature_calibration = val[0] == 0 ? false : true;
+		return OHMD_S_OK;
+
 	default:
 		return OHMD_S_INVALID_PARAMETER;
 	}
@@ -529,20 +852,12 @@ OHMD_APIENTRYDLL ohmd_status OHMD_APIENTRY ohmd_device_settings_seti(ohmd_device
 
 OHMD_APIENTRYDLL ohmd_device_settings* OHMD_APIENTRY ohmd_device_settings_create(ohmd_context* ctx)
 {
-	return ohmd_alloc(ctx, sizeof(ohmd_device_settings));
+	return ohmd_alloc_detached(ctx, sizeof(ohmd_device_settings));
 }
 
 OHMD_APIENTRYDLL void OHMD_APIENTRY ohmd_device_settings_destroy(ohmd_device_settings* settings)
 {
-	free(settings);
-}
-
-void* ohmd_allocfn(ohmd_context* ctx, const char* e_msg, size_t size)
-{
-	void* ret = calloc(1, size);
-	if(!ret)
-		ohmd_set_error(ctx, "%s", e_msg);
-	return ret;
+	ohmd_free_detached(settings);
 }
 
 void ohmd_set_default_device_properties(ohmd_device_properties* props)
@@ -598,6 +913,94 @@ void ohmd_set_universal_aberration_k(ohmd_device_properties* props, float r, flo
 	props->universal_aberration_k[2] = b;
 }
 
+struct ohmd_interned_string {
+	ohmd_interned_string* next;
+	char str[];
+};
+
+ohmd_device_desc* ohmd_device_list_add(ohmd_device_list* list)
+{
+	if(list->num_devices == list->max_devices){
+		int max = OHMD_MAX(16, list->max_devices * 2);
+		ohmd_device_desc* devices = ohmd_realloc(list->strings.ctx, list->devices, sizeof(ohmd_device_desc) * max);
+		if(!devices){
+			LOGE("could not allocate RAM for %d device descriptions", max);
+			return NULL;
+		}
+
+		list->devices = devices;
+		list->max_devices = max;
+	}
+
+	ohmd_device_desc* desc = &list->devices[list->num_devices++];
+	memset(desc, 0, sizeof(ohmd_device_desc));
+
+	desc->driver = desc->vendor = desc->product = desc->path = "";
+
+	return desc;
+}
+
+const char* ohmd_device_list_intern(ohmd_device_list* list, const char* str)
+{
+	// The same driver, vendor and path strings are repeated for most entries
+	for(ohmd_interned_string* is = list->interned; is; is = is->next){
+		if(strcmp(is->str, str) == 0)
+			return is->str;
+	}
+
+	size_t len = strlen(str) + 1;
+	ohmd_interned_string* is = ohmd_arena_alloc(&list->strings, sizeof(ohmd_interned_string) + len);
+	if(!is)
+		return "";
+
+	memcpy(is->str, str, len);
+	is->next = list->interned;
+	list->interned = is;
+
+	return is->str;
+}
+
+void ohmd_device_list_clear(ohmd_device_list* list)
+{
+	ohmd_arena_release(&list->strings);
+
+	// keep the entries allocated, probing usually finds the same devices again
+	list->interned = NULL;
+	list->num_devices = 0;
+}
+
+void ohmd_push_control_event(ohmd_device* device, int control, float old_value, float new_value)
+{
+	ohmd_control_event_queue* q = &device->control_events;
+	uint32_t head = q->head;
+
+	if(head - ohmd_atomic_load_u32(&q->tail) >= OHMD_MAX_CONTROL_EVENTS){
+		// queue is full, keep what the application hasn't seen yet
+		if(q->dropped++ == 0)
+			LOGW("control event queue full, dropping events");
+		return;
+	}
+
+	ohmd_control_event* ev = &q->events[head % OHMD_MAX_CONTROL_EVENTS];
+	ev->time = ohmd_get_tick();
+	ev->control = control;
+	ev->old_value = old_value;
+	ev->new_value = new_value;
+
+	ohmd_atomic_store_u32(&q->head, head + 1);
+}
+
+void ohmd_add_sample_stats(ohmd_device* device, uint32_t received, uint32_t dropped)
+{
+	ohmd_sample_stats* s = &device->sample_stats;
+
+	// only the update path writes these, so load + store is enough
+	ohmd_atomic_store_u32(&s->received, s->received + received);
+
+	if(dropped)
+		ohmd_atomic_store_u32(&s->dropped, s->dropped + dropped);
+}
+
 uint64_t ohmd_monotonic_per_sec(ohmd_context* ctx)
 {
 	return ctx->monotonic_ticks_per_sec;
@@ -21,7 +21,7 @@
 #include "platform.h"
 #include "utils.h"
 
-#define OHMD_MAX_DEVICES 16
+#define OHMD_MAX_CONTROL_EVENTS 64
 
 #define OHMD_MAX(_a, _b) ((_a) > (_b) ? (_a) : (_b))
 #define OHMD_MIN(_a, _b) ((_a) < (_b) ? (_a) : (_b))
@@ -35,20 +35,36 @@
 typedef struct ohmd_driver ohmd_driver;
 
 typedef struct {
-	char driver[OHMD_STR_SIZE];
-	char vendor[OHMD_STR_SIZE];
-	char product[OHMD_STR_SIZE];
-	char path[OHMD_STR_SIZE];
+	// interned with ohmd_device_list_intern(), valid until the next probe
+	const char* driver;
+	const char* vendor;
+	const char* product;
+	const char* path;
 	int revision;
 	int id;
 	ohmd_device_flags device_flags;
 	ohmd_device_class device_class;
 	ohmd_driver* driver_ptr;
+	int group; // assigned by ohmd_ctx_probe, drivers don't need to set this
 } ohmd_device_desc;
 
+typedef struct ohmd_arena_block ohmd_arena_block;
+
+// A linear allocator, everything allocated from it is freed at once by ohmd_arena_release().
+typedef struct {
+	ohmd_context* ctx;
+	ohmd_arena_block* blocks;
+	size_t block_size;
+} ohmd_arena;
+
+typedef struct ohmd_interned_string ohmd_interned_string;
+
 typedef struct {
 	int num_devices;
-	ohmd_device_desc devices[OHMD_MAX_DEVICES];
+	int max_devices;
+	ohmd_device_desc* devices;
+	ohmd_arena strings;
+	ohmd_interned_string* interned;
 } ohmd_device_list;
 
 struct ohmd_driver {
@@ -58,6 +74,24 @@ struct ohmd_driver {
 	ohmd_context* ctx;
 };
 
+// a tracking sensor (photodiode) or LED in the device's own frame
+typedef struct {
+	vec3f position;
+	vec3f normal;
+	uint32_t pattern; // LED blink pattern, 0 if none, see OHMD_TRACKING_SENSOR_PATTERNS
+} ohmd_tracking_sensor;
+
+// factory calibration of a camera, see OHMD_CAMERA_CALIBRATION
+typedef struct {
+	ohmd_camera_distortion_model model;
+	int width, height;
+	float fx, fy, cx, cy; // pixels
+	float k[6];
+	float p[2];
+	float rotation[9]; // row-major, camera to device
+	vec3f translation; // metres
+} ohmd_camera_calibration;
+
 typedef struct {
 		int hres;
 		int vres;
@@ -84,11 +118,36 @@ typedef struct {
 		mat4x4f proj_right; // adjusted projection matrix for right screen
 		float universal_distortion_k[4]; //PanoTools lens distiorion model [a,b,c,d]
 		float universal_aberration_k[3]; //post-warp per channel scaling [r,g,b]
+
+		// factory model of the tracking sensors/LEDs, owned by the driver. Drivers that learn it
+		// after open set it once from the update path, which runs with update_mutex held
+		int tracking_sensor_count;
+		const ohmd_tracking_sensor* tracking_sensors;
+
+		// factory camera calibration, owned by the driver
+		int camera_count;
+		const ohmd_camera_calibration* cameras;
 } ohmd_device_properties;
 
+// single producer (update path), single consumer (application) ring buffer
+typedef struct {
+	volatile uint32_t head; // next slot to write, only advanced by the producer
+	volatile uint32_t tail; // next slot to read, only advanced by the consumer
+	uint32_t dropped;
+	ohmd_control_event events[OHMD_MAX_CONTROL_EVENTS];
+} ohmd_control_event_queue;
+
+// sensor sample counters, written by the update path and read with atomic loads
+typedef struct {
+	volatile uint32_t received;
+	volatile uint32_t dropped;
+} ohmd_sample_stats;
+
 struct ohmd_device_settings
 {
 	bool automatic_update;
+	bool high_rate_sensors;
+	bool temperature_calibration;
 };
 
 struct ohmd_device {
@@ -98,11 +157,15 @@ struct ohmd_device {
 	vec3f position_correction;
 
 	int (*getf)(ohmd_device* device, ohmd_float_value type, float* out);
+	int (*geti)(ohmd_device* device, ohmd_int_value type, int* out); // optional, for values the core doesn't know
 	int (*setf)(ohmd_device* device, ohmd_float_value type, const float* in);
 	int (*seti)(ohmd_device* device, ohmd_int_value type, const int* in);
 	int (*set_data)(ohmd_device* device, ohmd_data_value type, const void* in);
 
 	void (*update)(ohmd_device* device);
+	// optional, fills fds with up to max input fds that wake the update thread and returns
+	// the count, 0 if the device has to be polled. update() must cope with a 10 ms cadence
+	int (*get_wait_fds)(ohmd_device* device, int* fds, int max);
 	void (*close)(ohmd_device* device);
 
 	ohmd_context* ctx;
@@ -110,6 +173,18 @@ struct ohmd_device {
 	ohmd_device_settings settings;
 
 	int active_device_idx; // index into ohmd_device->active_devices[]
+	int group;
+
+	// OHMD_TRACKING_SENSOR_COUNT as last returned, the application's buffers are sized from it
+	int tracking_sensors_reported;
+
+	ohmd_control_event_queue control_events;
+	ohmd_sample_stats sample_stats;
+
+	// last pose seen by the update path, pose_seq is bumped whenever it changes
+	quatf pose_rotation;
+	vec3f pose_position;
+	uint32_t pose_seq;
 
 	quatf rotation;
 	vec3f position;
@@ -122,17 +197,27 @@ struct ohmd_context {
 
 	ohmd_device_list list;
 
-	ohmd_device* active_devices[256];
+	ohmd_device** active_devices;
 	int num_active_devices;
+	int max_active_devices;
 
 	ohmd_thread* update_thread;
 	ohmd_mutex* update_mutex;
+	ohmd_cond* pose_cond;
+
+	ohmd_pose_callback pose_callback;
+	void* pose_callback_data;
 
 	bool update_request_quit;
 
 	uint64_t monotonic_ticks_per_sec;
 
 	char error_msg[OHMD_STR_SIZE];
+
+	ohmd_allocator allocator;
+	volatile uint64_t mem_current;
+	volatile uint64_t mem_peak;
+	volatile uint64_t mem_allocations;
 };
 
 // helper functions
@@ -144,6 +229,24 @@ void ohmd_set_default_device_properties(ohmd_device_properties* props);
 void ohmd_calc_default_proj_matrices(ohmd_device_properties* props);
 void ohmd_set_universal_distortion_k(ohmd_device_properties* props, float a, float b, float c, float d);
 void ohmd_set_universal_aberration_k(ohmd_device_properties* props, float r, float g, float b);
+void ohmd_push_control_event(ohmd_device* device, int control, float old_value, float new_value);
+void ohmd_add_sample_stats(ohmd_device* device, uint32_t received, uint32_t dropped);
+
+// memory helpers, see also ohmd_alloc in log.h
+struct nx_json_allocator;
+void ohmd_memory_init(ohmd_context* ctx, const ohmd_allocator* allocator);
+// for objects the application may free after destroying the context, such as device settings
+void* ohmd_alloc_detached(ohmd_context* ctx, size_t size);
+void ohmd_free_detached(void* ptr);
+void ohmd_arena_init(ohmd_arena* arena, ohmd_context* ctx, size_t block_size);
+void* ohmd_arena_alloc(ohmd_arena* arena, size_t size);
+void ohmd_arena_release(ohmd_arena* arena);
+void ohmd_arena_json_allocator(ohmd_arena* arena, struct nx_json_allocator* out);
+
+// device list helpers, a NULL return from ohmd_device_list_add means the list is out of memory
+ohmd_device_desc* ohmd_device_list_add(ohmd_device_list* list);
+const char* ohmd_device_list_intern(ohmd_device_list* list, const char* str);
+void ohmd_device_list_clear(ohmd_device_list* list);
 
 // drivers
 ohmd_driver* ohmd_create_dummy_drv(ohmd_context* ctx);
@@ -14,13 +14,17 @@
 #define CLOCK_MONOTONIC (clockid_t)4
 #endif
 
-#define _POSIX_C_SOURCE 199309L
+#define _POSIX_C_SOURCE 200112L
 
 #include <time.h>
 #include <sys/time.h>
 #include <stdio.h>
 #include <pthread.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 
 #include "platform.h"
 #include "openhmdi.h"
@@ -126,7 +130,7 @@ ohmd_thread* ohmd_create_thread(ohmd_context* ctx, unsigned int (*routine)(void*
 	int ret = pthread_create(&thread->thread, NULL, pthread_wrapper, thread);
 
 	if(ret != 0){
-		free(thread);
+		ohmd_free(thread);
 		thread = NULL;
 	}
 
@@ -142,7 +146,7 @@ ohmd_mutex* ohmd_create_mutex(ohmd_context* ctx)
 	int ret = pthread_mutex_init(mutex, NULL);
 
 	if(ret != 0){
-		free(mutex);
+		ohmd_free(mutex);
 		mutex = NULL;
 	}
 
@@ -152,13 +156,13 @@ ohmd_mutex* ohmd_create_mutex(ohmd_context* ctx)
 void ohmd_destroy_thread(ohmd_thread* thread)
 {
 	pthread_join(thread->thread, NULL);
-	free(thread);
+	ohmd_free(thread);
 }
 
 void ohmd_destroy_mutex(ohmd_mutex* mutex)
 {
 	pthread_mutex_destroy((pthread_mutex_t*)mutex);
-	free(mutex);
+	ohmd_free(mutex);
 }
 
 void ohmd_lock_mutex(ohmd_mutex* mutex)
@@ -173,6 +177,148 @@ void ohmd_unlock_mutex(ohmd_mutex* mutex)
 		pthread_mutex_unlock((pthread_mutex_t*)mutex);
 }
 
+uint32_t ohmd_atomic_load_u32(volatile uint32_t* ptr)
+{
+	return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+void ohmd_atomic_store_u32(volatile uint32_t* ptr, uint32_t value)
+{
+	__atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+uint64_t ohmd_atomic_add_u64(volatile uint64_t* ptr, int64_t delta)
+{
+	return __atomic_add_fetch(ptr, (uint64_t)delta, __ATOMIC_ACQ_REL);
+}
+
+void ohmd_atomic_store_u64(volatile uint64_t* ptr, uint64_t value)
+{
+	__atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+void ohmd_atomic_max_u64(volatile uint64_t* ptr, uint64_t value)
+{
+	uint64_t cur = __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+	while(cur < value && !__atomic_compare_exchange_n(ptr, &cur, value, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		;
+}
+
+ohmd_cond* ohmd_create_cond(ohmd_context* ctx)
+{
+	pthread_cond_t* cond = ohmd_alloc(ctx, sizeof(pthread_cond_t));
+	if(cond == NULL)
+		return NULL;
+
+	// waits time out against the monotonic clock, so wall clock changes don't stretch them.
+	// macOS has no clock attribute and waits with a relative timeout instead
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+#ifndef __APPLE__
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+
+	int ret = pthread_cond_init(cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	if(ret != 0){
+		ohmd_free(cond);
+		cond = NULL;
+	}
+
+	return (ohmd_cond*)cond;
+}
+
+void ohmd_destroy_cond(ohmd_cond* cond)
+{
+	pthread_cond_destroy((pthread_cond_t*)cond);
+	ohmd_free(cond);
+}
+
+int ohmd_cond_wait(ohmd_cond* cond, ohmd_mutex* mutex, double timeout)
+{
+	struct timespec ts;
+
+#ifdef __APPLE__
+	ts.tv_sec = (time_t)timeout;
+	ts.tv_nsec = (long)((timeout - ts.tv_sec) * 1000000000.0);
+
+	return pthread_cond_timedwait_relative_np((pthread_cond_t*)cond, (pthread_mutex_t*)mutex, &ts) == 0 ? 0 : 1;
+#else
+	// the deadline is absolute, on the clock the cond was created with
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	time_t sec = (time_t)timeout;
+	ts.tv_sec += sec;
+	ts.tv_nsec += (long)((timeout - sec) * 1000000000.0);
+	if(ts.tv_nsec >= 1000000000L){
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+
+	return pthread_cond_timedwait((pthread_cond_t*)cond, (pthread_mutex_t*)mutex, &ts) == 0 ? 0 : 1;
+#endif
+}
+
+void ohmd_cond_broadcast(ohmd_cond* cond)
+{
+	if(cond)
+		pthread_cond_broadcast((pthread_cond_t*)cond);
+}
+
+// input fds
+int ohmd_open_input_fd(const char* path)
+{
+	// every open hidraw file gets its own copy of each input report, so this
+	// works next to a hidapi handle on the same node
+	if(strncmp(path, "/dev/hidraw", 11) != 0)
+		return -1;
+
+	return open(path, O_RDONLY | O_NONBLOCK);
+}
+
+void ohmd_close_input_fd(int fd)
+{
+	close(fd);
+}
+
+int ohmd_read_input_fd(int fd, unsigned char* buf, int size)
+{
+	ssize_t ret = read(fd, buf, size);
+
+	if(ret < 0)
+		return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+
+	return (int)ret;
+}
+
+int ohmd_wait_fds(const int* fds, int count, double timeout)
+{
+	if(count <= 0){
+		ohmd_sleep(timeout);
+		return 0;
+	}
+
+	struct pollfd pfds[count];
+
+	for(int i = 0; i < count; i++){
+		pfds[i].fd = fds[i];
+		pfds[i].events = POLLIN;
+		pfds[i].revents = 0;
+	}
+
+	if(poll(pfds, count, (int)(timeout * 1000.0 + 0.5)) <= 0)
+		return 0;
+
+	// an unplugged device stays readable, without this the caller would spin
+	for(int i = 0; i < count; i++){
+		if(pfds[i].revents & (POLLERR | POLLHUP | POLLNVAL))
+			return -1;
+	}
+
+	return 0;
+}
+
 /// Handling ovr service
 void ohmd_toggle_ovr_service(int state) //State is 0 for Disable, 1 for Enable
 {
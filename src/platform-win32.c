@@ -61,7 +61,11 @@ struct ohmd_thread {
 };
 
 struct ohmd_mutex {
-	HANDLE handle;
+	CRITICAL_SECTION cs;
+};
+
+struct ohmd_cond {
+	CONDITION_VARIABLE cv;
 };
 
 DWORD __stdcall ohmd_thread_wrapper(void* t)
@@ -89,7 +93,7 @@ void ohmd_destroy_thread(ohmd_thread* thread)
 	ohmd_sleep(3);
 	WaitForSingleObject(thread->handle, INFINITE);
 	CloseHandle(thread->handle);
-	free(thread);
+	ohmd_free(thread);
 }
 
 ohmd_mutex* ohmd_create_mutex(ohmd_context* ctx)
@@ -98,27 +102,85 @@ ohmd_mutex* ohmd_create_mutex(ohmd_context* ctx)
 	if(!mutex)
 		return NULL;
 	
-	mutex->handle = CreateMutex(NULL, FALSE, NULL);
+	InitializeCriticalSection(&mutex->cs);
 
 	return mutex;
 }
 
 void ohmd_destroy_mutex(ohmd_mutex* mutex)
 {
-	CloseHandle(mutex->handle);
-	free(mutex);
+	DeleteCriticalSection(&mutex->cs);
+	ohmd_free(mutex);
 }
 
 void ohmd_lock_mutex(ohmd_mutex* mutex)
 {
 	if(mutex)
-		WaitForSingleObject(mutex->handle, INFINITE);
+		EnterCriticalSection(&mutex->cs);
 }
 
 void ohmd_unlock_mutex(ohmd_mutex* mutex)
 {
 	if(mutex)
-		ReleaseMutex(mutex->handle);
+		LeaveCriticalSection(&mutex->cs);
+}
+
+ohmd_cond* ohmd_create_cond(ohmd_context* ctx)
+{
+	ohmd_cond* cond = ohmd_alloc(ctx, sizeof(ohmd_cond));
+	if(!cond)
+		return NULL;
+
+	InitializeConditionVariable(&cond->cv);
+
+	return cond;
+}
+
+void ohmd_destroy_cond(ohmd_cond* cond)
+{
+	ohmd_free(cond);
+}
+
+int ohmd_cond_wait(ohmd_cond* cond, ohmd_mutex* mutex, double timeout)
+{
+	return SleepConditionVariableCS(&cond->cv, &mutex->cs, (DWORD)(timeout * 1000)) ? 0 : 1;
+}
+
+void ohmd_cond_broadcast(ohmd_cond* cond)
+{
+	if(cond)
+		WakeAllConditionVariable(&cond->cv);
+}
+
+uint32_t ohmd_atomic_load_u32(volatile uint32_t* ptr)
+{
+	return (uint32_t)InterlockedCompareExchange((volatile LONG*)ptr, 0, 0);
+}
+
+void ohmd_atomic_store_u32(volatile uint32_t* ptr, uint32_t value)
+{
+	InterlockedExchange((volatile LONG*)ptr, (LONG)value);
+}
+
+uint64_t ohmd_atomic_add_u64(volatile uint64_t* ptr, int64_t delta)
+{
+	return (uint64_t)(InterlockedExchangeAdd64((volatile LONG64*)ptr, delta) + delta);
+}
+
+void ohmd_atomic_store_u64(volatile uint64_t* ptr, uint64_t value)
+{
+	InterlockedExchange64((volatile LONG64*)ptr, (LONG64)value);
+}
+
+void ohmd_atomic_max_u64(volatile uint64_t* ptr, uint64_t value)
+{
+	LONG64 cur = InterlockedCompareExchange64((volatile LONG64*)ptr, 0, 0);
+	while((uint64_t)cur < value){
+		LONG64 prev = InterlockedCompareExchange64((volatile LONG64*)ptr, (LONG64)value, cur);
+		if(prev == cur)
+			break;
+		cur = prev;
+	}
 }
 
 int findEndPoint(char* path, int endpoint)
@@ -133,6 +195,27 @@ int findEndPoint(char* path, int endpoint)
 	return 0;
 }
 
+// input fds, hidraw only exists on Linux
+int ohmd_open_input_fd(const char* path)
+{
+	return -1;
+}
+
+void ohmd_close_input_fd(int fd)
+{
+}
+
+int ohmd_read_input_fd(int fd, unsigned char* buf, int size)
+{
+	return -1;
+}
+
+int ohmd_wait_fds(const int* fds, int count, double timeout)
+{
+	ohmd_sleep(timeout);
+	return 0;
+}
+
 /// Handling ovr service
 static int _enable_ovr_service = 0;
 
@@ -11,6 +11,8 @@
 #ifndef PLATFORM_H
 #define PLATFORM_H
 
+#include <stdint.h>
+
 #include "openhmd.h"
 
 double ohmd_get_tick();
@@ -18,6 +20,7 @@ void ohmd_toggle_ovr_service(int state);
 
 typedef struct ohmd_thread ohmd_thread;
 typedef struct ohmd_mutex ohmd_mutex;
+typedef struct ohmd_cond ohmd_cond;
 
 ohmd_mutex* ohmd_create_mutex(ohmd_context* ctx);
 void ohmd_destroy_mutex(ohmd_mutex* mutex);
@@ -25,9 +28,40 @@ void ohmd_destroy_mutex(ohmd_mutex* mutex);
 void ohmd_lock_mutex(ohmd_mutex* mutex);
 void ohmd_unlock_mutex(ohmd_mutex* mutex);
 
+ohmd_cond* ohmd_create_cond(ohmd_context* ctx);
+void ohmd_destroy_cond(ohmd_cond* cond);
+
+// mutex must be locked, returns 0 when signalled and 1 if timeout seconds passed first
+int ohmd_cond_wait(ohmd_cond* cond, ohmd_mutex* mutex, double timeout);
+void ohmd_cond_broadcast(ohmd_cond* cond);
+
 ohmd_thread* ohmd_create_thread(ohmd_context* ctx, unsigned int (*routine)(void* arg), void* arg);
 void ohmd_destroy_thread(ohmd_thread* thread);
 
+/* Input file descriptors, so the update thread can sleep until a device has
+ * input. Only hidraw device nodes are supported, elsewhere
+ * ohmd_open_input_fd() returns -1 and ohmd_wait_fds() just sleeps. */
+
+// opens the hidraw node at path read-only and non-blocking, -1 if it isn't one
+int ohmd_open_input_fd(const char* path);
+void ohmd_close_input_fd(int fd);
+// returns the report size, 0 if none is queued and -1 on errors
+int ohmd_read_input_fd(int fd, unsigned char* buf, int size);
+// returns once one of fds is readable or timeout seconds passed,
+// -1 if one of them is in an error state, such as an unplugged device
+int ohmd_wait_fds(const int* fds, int count, double timeout);
+
+/* Atomics, load has acquire and store has release semantics */
+
+uint32_t ohmd_atomic_load_u32(volatile uint32_t* ptr);
+void ohmd_atomic_store_u32(volatile uint32_t* ptr, uint32_t value);
+
+// returns the new value, add 0 to load
+uint64_t ohmd_atomic_add_u64(volatile uint64_t* ptr, int64_t delta);
+void ohmd_atomic_store_u64(volatile uint64_t* ptr, uint64_t value);
+// raises *ptr to value if it is lower
+void ohmd_atomic_max_u64(volatile uint64_t* ptr, uint64_t value);
+
 /* String functions */
 
 int findEndPoint(char* path, int endpoint);
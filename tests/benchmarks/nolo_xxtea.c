@@ -0,0 +1,72 @@
+// Copyright 2026, OpenHMD contributors.
+// SPDX-License-Identifier: BSL-1.0
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ */
+
+/* Benchmark - NOLO report decryption against the generic XXTEA reference */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "drv_nolo/nolo.h"
+
+#define REPORTS 4096
+#define REPEATS 100
+
+// The old decrypt path, byte packing around the generic btea_decrypt()
+static void reference_decrypt(unsigned char* buf)
+{
+	static const uint32_t key[4] = {0x875bcc51, 0xa7637a66, 0x50960967, 0xf8536c51};
+	uint32_t words[15];
+
+	for(int i = 0; i < 15; i++)
+		words[i] = (uint32_t)buf[1 + 4 * i] | (uint32_t)buf[2 + 4 * i] << 8 |
+		           (uint32_t)buf[3 + 4 * i] << 16 | (uint32_t)buf[4 + 4 * i] << 24;
+
+	btea_decrypt(words, 15, 1, key);
+
+	for(int i = 0; i < 15; i++){
+		buf[1 + 4 * i] = words[i];
+		buf[2 + 4 * i] = words[i] >> 8;
+		buf[3 + 4 * i] = words[i] >> 16;
+		buf[4 + 4 * i] = words[i] >> 24;
+	}
+}
+
+static double run(unsigned char (*reports)[FEATURE_BUFFER_SIZE], void (*decrypt)(unsigned char*))
+{
+	static unsigned char buf[REPORTS][FEATURE_BUFFER_SIZE];
+
+	clock_t start = clock();
+
+	for(int r = 0; r < REPEATS; r++){
+		memcpy(buf, reports, sizeof(buf));
+		for(int n = 0; n < REPORTS; n++)
+			decrypt(buf[n]);
+	}
+
+	return (double)(clock() - start) / CLOCKS_PER_SEC / (REPEATS * REPORTS) * 1e6;
+}
+
+// The unit tests check that both paths give the same output, this only times them
+int main()
+{
+	static unsigned char reports[REPORTS][FEATURE_BUFFER_SIZE];
+	uint32_t seed = 0x4e4f4c4f;
+
+	// random reports, with the report ids the driver sees
+	for(int n = 0; n < REPORTS; n++){
+		for(int i = 0; i < FEATURE_BUFFER_SIZE; i++){
+			seed = seed * 1664525u + 1013904223u;
+			reports[n][i] = seed >> 24;
+		}
+		reports[n][0] = n & 1 ? NOLO_CONTROLLER_1_HMD_SMP2 : NOLO_CONTROLLER_0_HMD_SMP1;
+	}
+
+	printf("reference: %8.4f us/report\n", run(reports, reference_decrypt));
+	printf("optimized: %8.4f us/report\n", run(reports, nolo_decrypt_data));
+
+	return 0;
+}
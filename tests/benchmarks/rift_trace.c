@@ -0,0 +1,87 @@
+// Copyright 2026, OpenHMD contributors.
+// SPDX-License-Identifier: BSL-1.0
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ */
+
+/* Benchmark - Rift per-report debug output, text dump vs. binary trace */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "drv_oculus_rift/rift.h"
+#include "drv_oculus_rift/rift-trace.h"
+
+#ifdef _WIN32
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+
+#define REPORTS 200000
+
+static void make_report(unsigned char* buffer, int n)
+{
+	memset(buffer, 0, 64);
+	buffer[0] = RIFT_IRQ_SENSORS_DK2;
+	buffer[3] = 2; // num samples
+	buffer[4] = (unsigned char)(n * 2);
+	buffer[5] = (unsigned char)(n * 2 >> 8);
+	for(int i = 0; i < 4; i++)
+		buffer[8 + i] = (unsigned char)((n * 2000u) >> (8 * i));
+	for(int i = 12; i < 44; i++)
+		buffer[i] = (unsigned char)(i * 37 + n);
+}
+
+typedef enum {
+	MODE_NONE,
+	MODE_TEXT_DUMP,
+	MODE_BINARY_TRACE,
+} bench_mode;
+
+static double run(bench_mode mode, rift_trace* trace)
+{
+	static unsigned char buffer[64];
+	pkt_tracker_sensor sensor;
+
+	clock_t start = clock();
+
+	for(int n = 0; n < REPORTS; n++){
+		make_report(buffer, n);
+
+		if(mode == MODE_BINARY_TRACE && trace)
+			rift_trace_report(trace, RIFT_TRACE_HMD, (uint64_t)n * 2000000, buffer, sizeof(buffer));
+
+		decode_tracker_sensor_msg_dk2(&sensor, buffer, sizeof(buffer));
+
+		if(mode == MODE_TEXT_DUMP)
+			dump_packet_tracker_sensor(&sensor);
+	}
+
+	return (double)(clock() - start) / CLOCKS_PER_SEC / REPORTS * 1e9;
+}
+
+int main()
+{
+	ohmd_context* ctx = ohmd_ctx_create();
+
+	// the text dump goes to stdout, results to stderr
+	if(!freopen(NULL_DEVICE, "w", stdout))
+		return 1;
+
+	rift_trace* trace = rift_trace_open(ctx, NULL_DEVICE);
+
+	double none_ns = run(MODE_NONE, NULL);
+	double text_ns = run(MODE_TEXT_DUMP, NULL);
+	double trace_ns = run(MODE_BINARY_TRACE, trace);
+
+	rift_trace_close(trace);
+	ohmd_ctx_destroy(ctx);
+
+	fprintf(stderr, "decode only:           %8.1f ns/report (tracing disabled)\n", none_ns);
+	fprintf(stderr, "decode + text dump:    %8.1f ns/report (LOGD per report, before)\n", text_ns);
+	fprintf(stderr, "decode + binary trace: %8.1f ns/report (OHMD_RIFT_TRACE set)\n", trace_ns);
+
+	return 0;
+}
@@ -0,0 +1,123 @@
+// Copyright 2026, OpenHMD contributors.
+// SPDX-License-Identifier: BSL-1.0
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ */
+
+/* Benchmark - WMR averaged vs. high rate gyro samples */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "drv_wmr/wmr.h"
+
+#define SUB_SAMPLE_RATE 8000.0 // Hz, 8 gyro sub-samples per 1 kHz accelerometer sample
+#define PACKETS 2500 // 10 seconds
+#define TRUTH_STEPS 16 // integration steps per sub-sample for the reference orientation
+#define REPEATS 20
+
+// Coning motion around a tilted axis, the kind of vibrating fast turn averaging smears
+static vec3f angular_velocity(double t)
+{
+	const double rate = 6.0, freq = 20.0;
+	vec3f w = {{ (float)(rate * cos(2 * M_PI * freq * t)), (float)(rate * sin(2 * M_PI * freq * t)), 1.0f }};
+	return w;
+}
+
+static void integrate(quatf* orient, const vec3f* w, float dt)
+{
+	float len = ovec3f_get_length(w);
+	if(len < 0.0001f)
+		return;
+
+	vec3f axis = {{ w->x / len, w->y / len, w->z / len }};
+	quatf delta;
+	oquatf_init_axis(&delta, &axis, len * dt);
+	oquatf_mult_me(orient, &delta);
+	oquatf_normalize_me(orient);
+}
+
+static void make_packet(hololens_sensors_packet* pkt, int n, quatf* truth)
+{
+	memset(pkt, 0, sizeof(*pkt));
+
+	for(int i = 0; i < 4; i++){
+		pkt->gyro_timestamp[i] = (uint64_t)(n * 4 + i + 1) * 10000;
+
+		for(int j = 0; j < 8; j++){
+			int k = i * 8 + j;
+			double t = ((n * 4 + i) * 8 + j) / SUB_SAMPLE_RATE;
+			vec3f w = angular_velocity(t);
+
+			// inverse of the axis mapping and scale in hololens_sensors_get_fusion_samples()
+			pkt->gyro[1][k] = (int16_t)lroundf(-w.x * 1000.0f);
+			pkt->gyro[0][k] = (int16_t)lroundf(-w.y * 1000.0f);
+			pkt->gyro[2][k] = (int16_t)lroundf(-w.z * 1000.0f);
+
+			for(int s = 0; s < TRUTH_STEPS; s++){
+				w = angular_velocity(t + s / (SUB_SAMPLE_RATE * TRUTH_STEPS));
+				integrate(truth, &w, (float)(1.0 / (SUB_SAMPLE_RATE * TRUTH_STEPS)));
+			}
+		}
+
+		pkt->accel[1][i] = -9810;
+	}
+}
+
+static float angle_error(const quatf* a, const quatf* b)
+{
+	float dot = fabsf(oquatf_get_dot(a, b));
+	return 2.0f * acosf(dot > 1.0f ? 1.0f : dot) * 180.0f / (float)M_PI;
+}
+
+static double run(const hololens_sensors_packet* packets, bool high_rate, quatf* out_orient)
+{
+	fusion f;
+	vec3f mag = {{0.0f, 0.0f, 0.0f}};
+	fusion_sample samples[HOLOLENS_HIGH_RATE_SAMPLES];
+	hololens_imu_transform gyro_transform, accel_transform;
+
+	// no factory calibration, the nominal scale only
+	hololens_imu_transform_init(&gyro_transform, NULL, 0.001f);
+	hololens_imu_transform_init(&accel_transform, NULL, 0.001f);
+
+	clock_t start = clock();
+
+	for(int r = 0; r < REPEATS; r++){
+		ofusion_init(&f);
+		f.flags = 0; // no gravity correction, only integration is measured
+
+		uint64_t last_tick = 0;
+		for(int n = 0; n < PACKETS; n++){
+			int count = hololens_sensors_get_fusion_samples(&packets[n], last_tick, high_rate,
+			                                                &gyro_transform, &accel_transform, samples);
+			ofusion_update_batch(&f, samples, count, &mag);
+			last_tick = packets[n].gyro_timestamp[3];
+		}
+	}
+
+	*out_orient = f.orient;
+
+	return (double)(clock() - start) / CLOCKS_PER_SEC / (REPEATS * PACKETS) * 1e6;
+}
+
+int main()
+{
+	static hololens_sensors_packet packets[PACKETS];
+	quatf truth = {{0, 0, 0, 1}};
+
+	for(int n = 0; n < PACKETS; n++)
+		make_packet(&packets[n], n, &truth);
+
+	quatf averaged, high_rate;
+	double averaged_us = run(packets, false, &averaged);
+	double high_rate_us = run(packets, true, &high_rate);
+
+	printf("averaged:  %8.3f us/packet, %8.4f deg drift after %d packets\n",
+	       averaged_us, angle_error(&averaged, &truth), PACKETS);
+	printf("high rate: %8.3f us/packet, %8.4f deg drift after %d packets\n",
+	       high_rate_us, angle_error(&high_rate, &truth), PACKETS);
+
+	return 0;
+}
@@ -8,6 +8,7 @@
 /* Unit Tests - High-level functions */
 
 #include "tests.h"
+#include <stdlib.h>
 #include "openhmd.h"
 
 void test_highlevel_open_close_device()
@@ -67,3 +68,318 @@ void test_highlevel_open_close_many_devices()
 	
 	ohmd_ctx_destroy(ctx);	
 }
+
+void test_highlevel_control_events()
+{
+	ohmd_context* ctx = ohmd_ctx_create();
+	TAssert(ctx);
+
+	int num_devices = ohmd_ctx_probe(ctx);
+	TAssert(num_devices > 0);
+
+	ohmd_device* hmd = ohmd_list_open_device(ctx, num_devices - 1);
+	TAssert(hmd);
+
+	ohmd_control_event events[4];
+
+	// The dummy device never changes its controls
+	ohmd_ctx_update(ctx);
+	TAssert(ohmd_device_get_control_events(hmd, events, 4) == 0);
+	TAssert(ohmd_device_get_control_events(hmd, events, -1) < 0);
+
+	int ret = ohmd_close_device(hmd);
+	TAssert(ret == 0);
+
+	ohmd_ctx_destroy(ctx);
+}
+
+void test_highlevel_control_event_queue()
+{
+	ohmd_context* ctx = ohmd_ctx_create();
+	TAssert(ctx);
+
+	int num_devices = ohmd_ctx_probe(ctx);
+	TAssert(num_devices > 0);
+
+	ohmd_device* hmd = ohmd_list_open_device(ctx, num_devices - 1);
+	TAssert(hmd);
+
+	ohmd_control_event events[OHMD_MAX_CONTROL_EVENTS + 8];
+
+	// Events come out in the order they were pushed, partial reads keep the rest
+	for(int i = 0; i < 3; i++)
+		ohmd_push_control_event(hmd, i, (float)i, (float)(i + 1));
+
+	TAssert(ohmd_device_get_control_events(hmd, events, 2) == 2);
+	TAssert(events[0].control == 0);
+	TAssert(events[1].control == 1);
+	TAssert(float_eq(events[1].old_value, 1.0f, 0.0001f));
+	TAssert(float_eq(events[1].new_value, 2.0f, 0.0001f));
+
+	TAssert(ohmd_device_get_control_events(hmd, events, 4) == 1);
+	TAssert(events[0].control == 2);
+	TAssert(float_eq(events[0].old_value, 2.0f, 0.0001f));
+	TAssert(float_eq(events[0].new_value, 3.0f, 0.0001f));
+	TAssert(ohmd_device_get_control_events(hmd, events, 4) == 0);
+
+	// A full queue keeps the oldest events and drops the new ones
+	for(int i = 0; i < OHMD_MAX_CONTROL_EVENTS + 8; i++)
+		ohmd_push_control_event(hmd, i, (float)i, (float)-i);
+
+	TAssert(ohmd_device_get_control_events(hmd, events, OHMD_MAX_CONTROL_EVENTS + 8) == OHMD_MAX_CONTROL_EVENTS);
+	for(int i = 0; i < OHMD_MAX_CONTROL_EVENTS; i++){
+		TAssert(events[i].control == i);
+		TAssert(float_eq(events[i].old_value, (float)i, 0.0001f));
+		TAssert(float_eq(events[i].new_value, (float)-i, 0.0001f));
+	}
+	TAssert(ohmd_device_get_control_events(hmd, events, 4) == 0);
+
+	// Draining frees the space again
+	ohmd_push_control_event(hmd, 7, 0.0f, 1.0f);
+	TAssert(ohmd_device_get_control_events(hmd, events, 4) == 1);
+	TAssert(events[0].control == 7);
+
+	int ret = ohmd_close_device(hmd);
+	TAssert(ret == 0);
+
+	ohmd_ctx_destroy(ctx);
+}
+
+void test_highlevel_tracking_sensor_model()
+{
+	ohmd_context* ctx = ohmd_ctx_create();
+	TAssert(ctx);
+
+	int num_devices = ohmd_ctx_probe(ctx);
+	TAssert(num_devices > 0);
+
+	ohmd_device* hmd = ohmd_list_open_device(ctx, num_devices - 1);
+	TAssert(hmd);
+
+	int count = -1;
+	TAssert(ohmd_device_geti(hmd, OHMD_TRACKING_SENSOR_COUNT, &count) == 0);
+	TAssert(count == 0);
+
+	// A model that arrives after the application sized its buffers isn't copied into them
+	static const ohmd_tracking_sensor sensors[4] = {
+		{ {{ 1, 2, 3 }}, {{ 0, 0, 1 }}, 0x5 },
+		{ {{ 4, 5, 6 }}, {{ 0, 1, 0 }}, 0x6 },
+		{ {{ 7, 8, 9 }}, {{ 1, 0, 0 }}, 0x7 },
+		{ {{ 1, 1, 1 }}, {{ 0, 0, -1 }}, 0x8 },
+	};
+	hmd->properties.tracking_sensors = sensors;
+	hmd->properties.tracking_sensor_count = 4;
+
+	float model[4 * 6 + 1] = { 0 };
+	int patterns[4 + 1] = { 0 };
+	TAssert(ohmd_device_getf(hmd, OHMD_TRACKING_SENSOR_MODEL, model) == 0);
+	TAssert(ohmd_device_geti(hmd, OHMD_TRACKING_SENSOR_PATTERNS, patterns) == 0);
+	TAssert(model[0] == 0.0f && patterns[0] == 0);
+
+	// Once the count is queried again the whole model is returned
+	TAssert(ohmd_device_geti(hmd, OHMD_TRACKING_SENSOR_COUNT, &count) == 0);
+	TAssert(count == 4);
+	TAssert(ohmd_device_getf(hmd, OHMD_TRACKING_SENSOR_MODEL, model) == 0);
+	TAssert(ohmd_device_geti(hmd, OHMD_TRACKING_SENSOR_PATTERNS, patterns) == 0);
+	TAssert(float_eq(model[6 * 3], 1.0f, 0.0001f));
+	TAssert(float_eq(model[6 * 3 + 5], -1.0f, 0.0001f));
+	TAssert(model[4 * 6] == 0.0f);
+	TAssert(patterns[3] == 0x8 && patterns[4] == 0);
+
+	hmd->properties.tracking_sensors = NULL;
+	hmd->properties.tracking_sensor_count = 0;
+
+	TAssert(ohmd_close_device(hmd) == 0);
+
+	ohmd_ctx_destroy(ctx);
+}
+
+static void OHMD_APIENTRY count_pose_callback(ohmd_context* ctx, void* user_data)
+{
+	(*(int*)user_data)++;
+}
+
+void test_highlevel_wait_pose()
+{
+	ohmd_context* ctx = ohmd_ctx_create();
+	TAssert(ctx);
+
+	int num_devices = ohmd_ctx_probe(ctx);
+	TAssert(num_devices > 0);
+
+	// Automatic updates, the update thread publishes the first pose
+	ohmd_device* hmd = ohmd_list_open_device(ctx, num_devices - 1);
+	TAssert(hmd);
+
+	unsigned int seq = 0;
+	TAssert(ohmd_device_wait_pose(hmd, seq, 1.0, &seq) == OHMD_S_OK);
+	TAssert(seq != 0);
+
+	// The dummy device never moves, so there is never a newer pose
+	TAssert(ohmd_device_wait_pose(hmd, seq, 0.01, NULL) == OHMD_S_TIMEOUT);
+	TAssert(ohmd_device_wait_pose(hmd, seq, -1.0, NULL) < 0);
+
+	TAssert(ohmd_close_device(hmd) == 0);
+
+	// Manual updates, the callback is called from ohmd_ctx_update
+	ohmd_device_settings* settings = ohmd_device_settings_create(ctx);
+	int auto_update = 0;
+	ohmd_device_settings_seti(settings, OHMD_IDS_AUTOMATIC_UPDATE, &auto_update);
+
+	hmd = ohmd_list_open_device_s(ctx, num_devices - 1, settings);
+	TAssert(hmd);
+	ohmd_device_settings_destroy(settings);
+
+	int calls = 0;
+	TAssert(ohmd_ctx_set_pose_callback(ctx, count_pose_callback, &calls) == 0);
+
+	ohmd_ctx_update(ctx);
+	TAssert(calls == 1);
+	ohmd_ctx_update(ctx);
+	TAssert(calls == 1);
+
+	TAssert(ohmd_ctx_set_pose_callback(ctx, NULL, NULL) == 0);
+	TAssert(ohmd_close_device(hmd) == 0);
+
+	ohmd_ctx_destroy(ctx);
+}
+
+void test_highlevel_open_device_group()
+{
+	ohmd_context* ctx = ohmd_ctx_create();
+	TAssert(ctx);
+
+	int num_devices = ohmd_ctx_probe(ctx);
+	TAssert(num_devices >= 3);
+
+	// The dummy driver publishes an HMD and two controllers as one group
+	int group = -1;
+	TAssert(ohmd_list_geti(ctx, num_devices - 1, OHMD_DEVICE_GROUP, &group) == 0);
+	for(int i = num_devices - 3; i < num_devices; i++){
+		int other = -1;
+		TAssert(ohmd_list_geti(ctx, i, OHMD_DEVICE_GROUP, &other) == 0);
+		TAssert(other == group);
+	}
+
+	ohmd_device* devs[4];
+
+	// Too small an output array opens nothing
+	TAssert(ohmd_list_open_device_group(ctx, num_devices - 1, NULL, devs, 2) < 0);
+
+	int count = ohmd_list_open_device_group(ctx, num_devices - 1, NULL, devs, 4);
+	TAssert(count == 3);
+
+	for(int i = 0; i < count; i++){
+		int other = -1;
+		TAssert(ohmd_device_geti(devs[i], OHMD_DEVICE_GROUP, &other) == 0);
+		TAssert(other == group);
+	}
+
+	for(int i = 0; i < count; i++)
+		TAssert(ohmd_close_device(devs[i]) == 0);
+
+	TAssert(ohmd_list_open_device_group(ctx, num_devices, NULL, devs, 4) < 0);
+
+	ohmd_ctx_destroy(ctx);
+}
+
+void test_highlevel_open_close_lots_of_devices()
+{
+	ohmd_context* ctx = ohmd_ctx_create();
+	TAssert(ctx);
+
+	int num_devices = ohmd_ctx_probe(ctx);
+	TAssert(num_devices > 0);
+
+	// More than the context used to have room for
+	static ohmd_device* hmds[300];
+
+	for(int i = 0; i < 300; i++){
+		hmds[i] = ohmd_list_open_device(ctx, num_devices - 1);
+		TAssert(hmds[i]);
+	}
+
+	// Re-probing must not invalidate open devices
+	TAssert(ohmd_ctx_probe(ctx) == num_devices);
+	TAssert(ohmd_list_gets(ctx, num_devices - 1, OHMD_PRODUCT) != NULL);
+	TAssert(ohmd_list_gets(ctx, num_devices, OHMD_PRODUCT) == NULL);
+	TAssert(ohmd_list_gets(ctx, -1, OHMD_PRODUCT) == NULL);
+
+	for(int i = 299; i >= 0; i--){
+		int ret = ohmd_close_device(hmds[i]);
+		TAssert(ret == 0);
+	}
+
+	ohmd_ctx_destroy(ctx);
+}
+
+typedef struct {
+	int allocs;
+	int frees;
+} counting_allocator;
+
+static void* OHMD_APIENTRY counting_alloc(size_t size, void* user_data)
+{
+	((counting_allocator*)user_data)->allocs++;
+	return malloc(size);
+}
+
+static void OHMD_APIENTRY counting_free(void* ptr, void* user_data)
+{
+	((counting_allocator*)user_data)->frees++;
+	free(ptr);
+}
+
+void test_highlevel_memory_stats()
+{
+	counting_allocator counter = { 0, 0 };
+	ohmd_allocator allocator = { counting_alloc, counting_free, &counter };
+
+	ohmd_context* ctx = ohmd_ctx_create_with_allocator(&allocator);
+	TAssert(ctx);
+
+	int num_devices = ohmd_ctx_probe(ctx);
+	TAssert(num_devices > 0);
+
+	// The first open sizes the active device array, which is kept around
+	ohmd_device* hmd = ohmd_list_open_device(ctx, num_devices - 1);
+	TAssert(hmd);
+	TAssert(ohmd_close_device(hmd) == 0);
+
+	ohmd_memory_stats before;
+	TAssert(ohmd_ctx_get_memory_stats(ctx, &before, 1) == OHMD_S_OK);
+	TAssert(before.current_bytes > 0);
+	TAssert(before.peak_bytes > before.current_bytes);
+
+	// The peak is reset to the current usage after being reported
+	ohmd_ctx_get_memory_stats(ctx, &before, 0);
+	TAssert(before.peak_bytes == before.current_bytes);
+
+	hmd = ohmd_list_open_device(ctx, num_devices - 1);
+	TAssert(hmd);
+
+	ohmd_memory_stats opened;
+	ohmd_ctx_get_memory_stats(ctx, &opened, 0);
+	TAssert(opened.current_bytes > before.current_bytes);
+	TAssert(opened.peak_bytes >= opened.current_bytes);
+	TAssert(opened.num_allocations > before.num_allocations);
+
+	TAssert(ohmd_close_device(hmd) == 0);
+
+	ohmd_memory_stats closed;
+	ohmd_ctx_get_memory_stats(ctx, &closed, 0);
+	TAssert(closed.current_bytes == before.current_bytes);
+	TAssert(closed.peak_bytes == opened.peak_bytes);
+
+	// Settings come from the allocator but may outlive the context
+	ohmd_device_settings* settings = ohmd_device_settings_create(ctx);
+	TAssert(settings);
+
+	ohmd_ctx_destroy(ctx);
+	TAssert(counter.allocs == counter.frees + 1);
+
+	ohmd_device_settings_destroy(settings);
+
+	TAssert(counter.allocs > 0);
+	TAssert(counter.allocs == counter.frees);
+}
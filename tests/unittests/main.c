@@ -37,6 +37,18 @@ int main()
 	printf("high level tests\n");
 	Test(test_highlevel_open_close_device);
 	Test(test_highlevel_open_close_many_devices);
+	Test(test_highlevel_open_close_lots_of_devices);
+	Test(test_highlevel_control_events);
+	Test(test_highlevel_control_event_queue);
+	Test(test_highlevel_tracking_sensor_model);
+	Test(test_highlevel_wait_pose);
+	Test(test_highlevel_open_device_group);
+	Test(test_highlevel_memory_stats);
+	printf("\n");
+
+	printf("driver tests\n");
+	Test(test_nolo_decrypt_data);
+	Test(test_psvr_sync_bursty);
 	printf("\n");
 
 	printf("all a-ok\n");
@@ -0,0 +1,55 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Unit Tests - NOLO report decryption */
+
+#include "tests.h"
+#include <string.h>
+#include "drv_nolo/nolo.h"
+
+// The old decrypt path, byte packing around the generic btea_decrypt()
+static void reference_decrypt(unsigned char* buf)
+{
+	static const uint32_t key[4] = {0x875bcc51, 0xa7637a66, 0x50960967, 0xf8536c51};
+	uint32_t words[15];
+
+	for(int i = 0; i < 15; i++)
+		words[i] = (uint32_t)buf[1 + 4 * i] | (uint32_t)buf[2 + 4 * i] << 8 |
+		           (uint32_t)buf[3 + 4 * i] << 16 | (uint32_t)buf[4 + 4 * i] << 24;
+
+	btea_decrypt(words, 15, 1, key);
+
+	for(int i = 0; i < 15; i++){
+		buf[1 + 4 * i] = words[i];
+		buf[2 + 4 * i] = words[i] >> 8;
+		buf[3 + 4 * i] = words[i] >> 16;
+		buf[4 + 4 * i] = words[i] >> 24;
+	}
+}
+
+void test_nolo_decrypt_data()
+{
+	uint32_t seed = 0x4e4f4c4f;
+
+	// random reports with the report ids the driver sees, both paths must agree exactly
+	for(int n = 0; n < 1024; n++){
+		unsigned char report[FEATURE_BUFFER_SIZE];
+		unsigned char reference[FEATURE_BUFFER_SIZE];
+
+		for(int i = 0; i < FEATURE_BUFFER_SIZE; i++){
+			seed = seed * 1664525u + 1013904223u;
+			report[i] = seed >> 24;
+		}
+		report[0] = n & 1 ? NOLO_CONTROLLER_1_HMD_SMP2 : NOLO_CONTROLLER_0_HMD_SMP1;
+		memcpy(reference, report, sizeof(report));
+
+		nolo_decrypt_data(report);
+		reference_decrypt(reference);
+
+		TAssert(memcmp(report, reference, sizeof(report)) == 0);
+	}
+}
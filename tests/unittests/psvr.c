@@ -0,0 +1,88 @@
+/*
+ * OpenHMD - Free and Open Source API and drivers for immersive technology.
+ * Copyright (C) 2013 Fredrik Hultin.
+ * Copyright (C) 2013 Jakob Bornecrantz.
+ * Distributed under the Boost 1.0 licence, see LICENSE for full text.
+ */
+
+/* Unit Tests - PSVR sensor stream sync */
+
+#include "tests.h"
+#include <string.h>
+#include "drv_psvr/psvr.h"
+
+static void make_packet(psvr_sensor_packet* pkt, uint32_t tick)
+{
+	memset(pkt, 0, sizeof(*pkt));
+	pkt->samples[0].tick = tick & TICK_MASK;
+	pkt->samples[1].tick = (tick + SAMPLE_TICKS) & TICK_MASK;
+}
+
+// feeds count packets read in one go at host time now, returns how many were fused
+static int feed_burst(psvr_sync* sync, uint32_t* tick, int count, double now)
+{
+	int fused = 0;
+	for (int i = 0; i < count; i++) {
+		psvr_sensor_packet pkt;
+		uint32_t delta;
+
+		make_packet(&pkt, *tick);
+		*tick += 2 * SAMPLE_TICKS;
+		if (psvr_sync_packet(sync, &pkt, now, &delta))
+			fused++;
+	}
+
+	return fused;
+}
+
+void test_psvr_sync_bursty()
+{
+	psvr_sync sync;
+	double now = 100.0;
+	uint32_t tick = 5000000;
+
+	psvr_sync_init(&sync, now);
+	TAssert(sync.state == PSVR_SYNC_STARTUP);
+
+	// the replayed backlog arrives all at once right after opening
+	TAssert(feed_burst(&sync, &tick, 400, now + 0.05) == 0);
+	TAssert(sync.state == PSVR_SYNC_STARTUP);
+
+	// live data polled at 10 Hz comes in bursts of 100 packets, nothing is fused until the
+	// drain window is over
+	tick = 100;
+	for (int i = 1; i < SYNC_DRAIN_TIME * 10; i++)
+		TAssert(feed_burst(&sync, &tick, 100, now + i * 0.1) == 0);
+	now += SYNC_DRAIN_TIME;
+
+	// a burst with lost packets in the middle still syncs
+	TAssert(feed_burst(&sync, &tick, 30, now) == 0);
+	tick += 10 * SAMPLE_TICKS;
+	TAssert(feed_burst(&sync, &tick, 70, now) == 70 - (SYNC_PACKETS - 30 - 1));
+	TAssert(sync.state == PSVR_SYNC_RUNNING);
+	TAssert(sync.reset_fusion);
+	sync.reset_fusion = false;
+
+	// the first packet after syncing uses the nominal interval, then the gaps are passed on
+	psvr_sensor_packet pkt;
+	uint32_t delta = 0;
+	tick += 4 * SAMPLE_TICKS;
+	make_packet(&pkt, tick);
+	TAssert(psvr_sync_packet(&sync, &pkt, now, &delta));
+	TAssert(delta == 5 * SAMPLE_TICKS);
+	tick += 2 * SAMPLE_TICKS;
+
+	// a stall resyncs and keeps the orientation
+	tick += 2 * MAX_GAP_TICKS;
+	TAssert(feed_burst(&sync, &tick, SYNC_PACKETS - 1, now + 0.1) == 0);
+	TAssert(sync.state == PSVR_SYNC_RESYNC);
+	TAssert(!sync.reset_fusion);
+	TAssert(feed_burst(&sync, &tick, 1, now + 0.1) == 1);
+	TAssert(sync.state == PSVR_SYNC_RUNNING);
+
+	// the counter jumping back needs a fresh orientation
+	tick -= 10000;
+	TAssert(feed_burst(&sync, &tick, SYNC_PACKETS, now + 0.2) == 1);
+	TAssert(sync.state == PSVR_SYNC_RUNNING);
+	TAssert(sync.reset_fusion);
+}
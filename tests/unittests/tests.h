@@ -43,5 +43,16 @@ void test_oquatf_get_mat4x4();
 // high-level tests
 void test_highlevel_open_close_device();
 void test_highlevel_open_close_many_devices();
+void test_highlevel_open_close_lots_of_devices();
+void test_highlevel_control_events();
+void test_highlevel_control_event_queue();
+void test_highlevel_tracking_sensor_model();
+void test_highlevel_wait_pose();
+void test_highlevel_open_device_group();
+void test_highlevel_memory_stats();
+
+// driver tests
+void test_nolo_decrypt_data();
+void test_psvr_sync_bursty();
 
 #endif